@@ -43,15 +43,17 @@ LIB := $(MY_PATH)lib
 #   -Werror    Αντιμετωπίζει τα warnings σαν errors, σταματώντας το compilation
 #   -MDD       Δημιουργεί ένα .d αρχείο με τα dependencies, το οποίο μπορούμε να κάνουμε include στο Makefile
 #			   , το οποίο συμπεριλαμβάνει όλα τα header files που γίνονται include
+#   -pthread   Ενεργοποιεί την υποστήριξη για threads (std::thread)
 #
 # Το override επιτρέπει την προσθήκη επιπλέον παραμέτρων από τη γραμμή εντολών: make CFLAGS=...
 #
-override CXXFLAGS += -O3 -Wall -Wextra -MMD -I$(INCLUDE1) -I$(INCLUDE2) -I. -std=c++17 -fPIC
+override CXXFLAGS += -O3 -Wall -Wextra -MMD -I$(INCLUDE1) -I$(INCLUDE2) -I. -std=c++17 -fPIC -pthread
 
 # Linker options
 #   -lm        Link με τη math library
+#   -pthread   Link με τη βιβλιοθήκη των threads
 #
-LDFLAGS += -lm
+LDFLAGS += -lm -pthread
 
 # Αν στα targets με τα οποία έχει κληθεί το make (μεταβλητή MAKECMDGOALS) υπάρχει κάποιο
 # coverage*, τότε προσθέτουμε το --coverage στα compile & link flags
@@ -7,15 +7,17 @@ libname = pathlib.Path().absolute() / "lib" / "shared_lib.so"
 lib = ctypes.CDLL(libname)
 
 class config(Structure):
-    _fields_ = [('model', c_char_p), # algorithm name ("BRUTE", "LSH", "CUBE", "GNNS", "MRNG", "NSG" for ann / "CLASSIC", "LSH", "CUBE" for kmeans)
+    _fields_ = [('model', c_char_p), # algorithm name ("BRUTE", "LSH", "CUBE", "KDFOREST", "GNNS", "MRNG", "NSG" for ann / "CLASSIC", "BATCH", "ACCELERATED", "MINI_BATCH", "LSH", "CUBE" for kmeans)
                 ('vals', POINTER(c_int)), # array of int parameters given with the following order for each method:
                                           # (K, L, table_size, query_trick for LSH)
                                           # (K, M, probes for CUBE)
+                                          # (number of trees, max leaves visited for KDFOREST)
                                           # (K, E, R for GNNS)
                                           # (l for MRNG)
                                           # (l, m, k, lq for NSG)
                                           # (L, K, limit_queries for reversed LSH)
                                           # (M, K, probes for reversed CUBE)
+                                          # (batch size, iterations for MINI_BATCH)
                 ('window', c_double),
                 ('dataset', c_char_p), # initial dataset
                 ('query', c_char_p),
@@ -32,12 +34,12 @@ class sil_struct: # struct for silhouette (double array of size 10 for each clus
 
 # AAF: Average Approximation Factor
 
-def lsh_test(input, query, queries_num, k, L, table_size, window_size, query_trick, N, int_data=1):
-    lib.get_lsh_results.argtypes = (ctypes.c_char_p, ctypes.c_char_p, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_double, ctypes.c_bool, ctypes.c_int, ctypes.c_int, ctypes.POINTER(ctypes.c_double), ctypes.POINTER(ctypes.c_double), ctypes.POINTER(ctypes.c_int))
+def lsh_test(input, query, queries_num, k, L, table_size, window_size, query_trick, N, int_data=1, index_file=b''): # index_file is loaded if it exists, otherwise the index is built and saved there
+    lib.get_lsh_results.argtypes = (ctypes.c_char_p, ctypes.c_char_p, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_double, ctypes.c_bool, ctypes.c_int, ctypes.c_int, ctypes.c_char_p, ctypes.POINTER(ctypes.c_double), ctypes.POINTER(ctypes.c_double), ctypes.POINTER(ctypes.c_int))
     average_time = ctypes.c_double()
     aaf = ctypes.c_double()
     min_neighbors = ctypes.c_int()
-    lib.get_lsh_results(input, query, queries_num, k, L, table_size, window_size, query_trick, N, int_data, ctypes.byref(average_time), ctypes.byref(aaf), ctypes.byref(min_neighbors))
+    lib.get_lsh_results(input, query, queries_num, k, L, table_size, window_size, query_trick, N, int_data, index_file, ctypes.byref(average_time), ctypes.byref(aaf), ctypes.byref(min_neighbors))
     return average_time, aaf, min_neighbors
 
 def hypercube_test(input, query, queries_num, k, M, probes, N, window = 1000, int_data=1):
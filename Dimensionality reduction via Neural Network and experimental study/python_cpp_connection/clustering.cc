@@ -53,6 +53,22 @@ vector<variant<double, int>> helper_arg_cluster(KMeans *structure, struct config
         method = CLASSIC;
         config_tuple = make_tuple(0, 0, 0, 0, 0, 0, 0);
     }
+    else if (method_str == "BATCH") {
+        method = BATCH;
+        config_tuple = make_tuple(0, 0, 0, 0, 0, 0, 0);
+    }
+    else if (method_str == "ACCELERATED") {
+        method = ACCELERATED;
+        config_tuple = make_tuple(0, 0, 0, 0, 0, 0, 0);
+    }
+    else if (method_str == "MINI_BATCH") {
+        method = MINI_BATCH;
+        config_tuple = make_tuple(0, 0, 0, 0, 0, 0, 0);
+        kmeans_options options;
+        options.batch_size = config->vals[0];
+        options.batch_iterations = config->vals[1];
+        structure->set_options(options);
+    }
     else if (method_str == "LSH") {
         method = REVERSE_LSH;
         config_tuple = make_tuple(config->vals[0], config->vals[1], 0, 0, 0, config->window, config->vals[2]);
@@ -70,18 +86,11 @@ vector<variant<double, int>> helper_arg_cluster(KMeans *structure, struct config
     clock_t end = clock();
     double clustering_time = (double)(end - start) / CLOCKS_PER_SEC;
 
-    vector<vector<int>> clusters = structure->get_clusters();
-    vector<double> si(clusters.size(), 0);
-    double stotal = 0;
-    for (int i = 0; i < (int) clusters.size(); i++) {
-        for (int j = 0; j < (int) clusters[i].size(); j++) {
-            si[i] += structure->silhouette(clusters[i][j]);
-        }
-        stotal += si[i];
-        si[i] /= clusters[i].size();
-        (*sil)[i] = si[i];
+    silhouette_result silhouette = structure->silhouette(silhouette_options());
+    for (int i = 0; i < (int) silhouette.clusters.size(); i++) {
+        (*sil)[i] = silhouette.clusters[i];
     }
-    stotal /= structure->get_dataset_size();
+    double stotal = silhouette.total;
 
     // Return time, stotal.
     return {clustering_time, stotal};
@@ -111,7 +120,7 @@ extern "C" void get_kmeans_results(struct config *config, int int_data,
 	*stotal = get<double>(results[1]);
 
     // Compute objective function.
-    *obj_func = compute_objective_function(dataset, kmeans->get_clusters(), kmeans->get_centroids());
+    *obj_func = kmeans->objective();
 
 	delete kmeans;
 }
@@ -174,6 +183,19 @@ extern "C" void get_kmeans(struct config* config, void **kmeansnew)
     if (method_str == "CLASSIC") {
         method = CLASSIC;
     }
+    else if (method_str == "BATCH") {
+        method = BATCH;
+    }
+    else if (method_str == "ACCELERATED") {
+        method = ACCELERATED;
+    }
+    else if (method_str == "MINI_BATCH") {
+        method = MINI_BATCH;
+        kmeans_options options;
+        options.batch_size = config->vals[0];
+        options.batch_iterations = config->vals[1];
+        kmeans->set_options(options);
+    }
     else if (method_str == "LSH") {
         method = REVERSE_LSH;
         L = config->vals[0];
@@ -1,6 +1,6 @@
 struct config
 {
-    char* model;   // BRUTE, LSH, CUBE, MRNG, NSG, GNN options.
+    char* model;   // BRUTE, LSH, CUBE, KDFOREST, MRNG, NSG, GNN options.
     int *vals;     // Algorithm integer only parameters.
     double window; // window parameter for LSH, CUBE.
     const char *dataset;
@@ -3,10 +3,6 @@
 
 // For evaluating the K-Means algorithm in projected latent space.
 class KMeansEval : public KMeans {
-	private:
-		// Returns the silhouette of the cluster with the given index.
-		double silhouette(int i, std::vector<std::vector<double>> &initial_dataset, std::vector<std::vector<double>> &decoded_centroids);
-
 	public:
 		KMeansEval(const std::vector<std::vector<double>>& dataset);
 		
@@ -8,6 +8,7 @@
 #include <ctime>
 #include <limits>
 #include <vector>
+#include <stdexcept>
 
 #include "helper.hpp"
 #include "handling.hpp"
@@ -16,6 +17,8 @@
 #include "config.hpp"
 
 #include "brute_force.hpp"
+#include "ground_truth.hpp"
+#include "kd_forest.hpp"
 #include "lsh.hpp"
 #include "hypercube.hpp"
 #include "kmeans.hpp"
@@ -44,6 +47,8 @@ vector<variant<double, int>> helper_arg(void *structure, const vector<vector<dou
 	double aaf = 0; // Average approximate factor.
 	int min_neighbors = numeric_limits<int>::max();
 
+	// The exact nearest neighbours are computed once for the dataset and the queries and then loaded from a file.
+	GroundTruth truth = ground_truth(dataset, queries, N);
 	for (int q = 0; q < (int) queries.size(); q++) {
 		tuple<vector<int>, vector<double>> ann;
 		clock_t start_ANN = clock();
@@ -58,7 +63,7 @@ vector<variant<double, int>> helper_arg(void *structure, const vector<vector<dou
 			ann = ((LSH*) structure)->query(queries[q], N, euclidean_distance, query_trick);
 		}
 		else if (m == 4) {
-			vector<int> q_proj = ((hypercube*) structure)->calculate_q_proj(queries[q]);
+			uint64_t q_proj = ((hypercube*) structure)->calculate_q_proj(queries[q]);
 			ann = ((hypercube*) structure)->query(queries[q], q_proj, N);
 		}
 		else if (m == 5){
@@ -79,12 +84,9 @@ vector<variant<double, int>> helper_arg(void *structure, const vector<vector<dou
 		clock_t end_ANN = clock();
 		elapsed_secs_ANN += double(end_ANN - start_ANN) / CLOCKS_PER_SEC;
 
-		tuple<vector<int>, vector<double>> tnn = brute_force(dataset, queries[q], N);
-		
         vector<int> indices_ann = get<0>(ann);
         vector<double> distances_ann = get<1>(ann);
-        vector<int> indices_tnn = get<0>(tnn);
-        vector<double> distances_tnn = get<1>(tnn);
+        vector<double> distances_tnn = truth.distances[q];
 
 		// Take the average approximate factor from all neighbors.
 		double af = 0;
@@ -100,10 +102,11 @@ vector<variant<double, int>> helper_arg(void *structure, const vector<vector<dou
 }
 
 extern "C" void get_lsh_results(const char *input, const char *query, int queries_num,
-								int k, int L, int table_size, double window, bool query_trick, int N, int int_data,
+								int k, int L, int table_size, double window, bool query_trick, int N, int int_data, const char *index_file,
 								double *approximate_time, double *aaf, int *min_neighbors) {
 	string input_str(input);
 	string query_str(query);
+	string index_file_str(index_file);
 
 	vector <vector<double>> dataset;
 	vector <vector<double>> queries;
@@ -117,7 +120,26 @@ extern "C" void get_lsh_results(const char *input, const char *query, int querie
 	}
 
 
-	LSH *lsh = new LSH(k, L, table_size, window, dataset);
+	// Load the index if it has already been saved, otherwise build it and save it for later runs.
+	LSH *lsh = NULL;
+	if (!index_file_str.empty() && file_exists(index_file_str)) {
+		ifstream lsh_file(index_file_str, ios::binary);
+		try {
+			lsh = new LSH(lsh_file, dataset);
+		}
+		catch (const runtime_error &error) {
+			cout << error.what() << ", building it again: " << index_file_str << endl;
+		}
+		lsh_file.close();
+	}
+	if (lsh == NULL) {
+		lsh = new LSH(k, L, table_size, window, dataset);
+		if (!index_file_str.empty()) {
+			ofstream lsh_file(index_file_str, ios::binary);
+			lsh->save(lsh_file);
+			lsh_file.close();
+		}
+	}
 
 	// Return time, aaf.
 	vector<variant<int, bool>> params = {3, 0, 0, 0, N, query_trick};
@@ -333,7 +355,21 @@ extern "C" void get_aaf(const char* load_file, int queries_num, struct config* c
 		int L = config->vals[1];
 		int table_size = config->vals[2];
 		double window = config->window;
-		structure = new LSH(k, L, table_size, window, encoded_dataset);
+		structure = NULL;
+		if (!load_file_str.empty()) {
+			ifstream lsh_file;
+			lsh_file.open(load_file, ios::binary);
+			try {
+				structure = new LSH(lsh_file, encoded_dataset);
+			}
+			catch (const runtime_error &error) {
+				cout << error.what() << ", building it again: " << load_file_str << endl;
+			}
+			lsh_file.close();
+		}
+		if (structure == NULL) {
+			structure = new LSH(k, L, table_size, window, encoded_dataset);
+		}
 	}
 	else if (strcmp(config->model, "CUBE") == 0) {
 		int k = config->vals[0];
@@ -342,6 +378,11 @@ extern "C" void get_aaf(const char* load_file, int queries_num, struct config* c
 		double window = config->window;
 		structure = new hypercube(encoded_dataset, k, M, probes, window);
 	}
+	else if (strcmp(config->model, "KDFOREST") == 0) {
+		int number_of_trees = config->vals[0];
+		int max_leaves = config->vals[1];
+		structure = new KDForest(encoded_dataset, number_of_trees, max_leaves);
+	}
 	else if (strcmp(config->model, "GNNS") == 0) {
 		ApproximateKNNGraph *approximate_knn_graph;
 		if (!load_file_str.empty()) {
@@ -401,13 +442,13 @@ extern "C" void get_aaf(const char* load_file, int queries_num, struct config* c
 		exit(1);
 	}
 
-	// Calculate aaf.
+	// Calculate aaf, loading the exact nearest neighbours in initial space from the ground truth file.
+	GroundTruth truth = ground_truth(dataset, queries, 1);
 	double aaf_ = 0;
 	double time_ = 0;
 	for (int q = 0; q < queries_num; q++) {
 		vector<double> query_init = queries[q];
-		tuple<vector<int>, vector<double>> true_nn_init_ = brute_force(dataset, query_init, 1);
-		vector<double> true_nn_init = dataset[get<0>(true_nn_init_)[0]]; // Exact NN of q in initial space.
+		vector<double> true_nn_init = dataset[truth.indices[q][0]]; // Exact NN of q in initial space.
 		vector<double> query_enc = encoded_queries[q];
 		tuple<vector<int>, vector<double>> ann_enc_;
 
@@ -418,9 +459,12 @@ extern "C" void get_aaf(const char* load_file, int queries_num, struct config* c
 			ann_enc_ = ((LSH*) structure)->query(query_enc, 1, euclidean_distance, query_trick);
 		}
 		else if (strcmp(config->model, "CUBE") == 0) {
-			vector<int> q_proj = ((hypercube*) structure)->calculate_q_proj(query_enc);
+			uint64_t q_proj = ((hypercube*) structure)->calculate_q_proj(query_enc);
 			ann_enc_ = ((hypercube*) structure)->query(query_enc, q_proj, 1);
 		}
+		else if (strcmp(config->model, "KDFOREST") == 0) {
+			ann_enc_ = ((KDForest*) structure)->query(query_enc, 1);
+		}
 		else if (strcmp(config->model, "GNNS") == 0) {
 			int E = config->vals[1];
 			int R = config->vals[2];
@@ -467,6 +511,9 @@ extern "C" void get_aaf(const char* load_file, int queries_num, struct config* c
 	else if (strcmp(config->model, "CUBE") == 0) {
 		delete (hypercube*) structure;
 	}
+	else if (strcmp(config->model, "KDFOREST") == 0) {
+		delete (KDForest*) structure;
+	}
 	else if (strcmp(config->model, "MRNG") == 0) {
 		delete (MRNG*) structure;
 	}
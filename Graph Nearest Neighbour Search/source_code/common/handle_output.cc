@@ -11,7 +11,7 @@
 #include "mrng.hpp"
 #include "nsg.hpp"
 #include "lp_metric.hpp"
-#include "brute_force.hpp"
+#include "ground_truth.hpp"
 
 using namespace std;
 
@@ -41,6 +41,9 @@ void handle_ouput(void *structure, const vector<vector<double>> &dataset, const
 	double elapsed_secs_TNN = 0;
 	double aaf = 0; // Average approximate factor.
 
+	// The exact nearest neighbours are computed once for the dataset and the queries and then loaded from a file.
+	// They are timed one query at a time for tTrue.
+	GroundTruth truth = ground_truth(dataset, queries, N, "euclidean", euclidean_distance, GROUND_TRUTH_DIRECTORY, true);
 	for (int q = 0; q < (int) queries.size(); q++) {
 		cout << "Query: " << q << endl;
 		output << "Query: " << q << endl;
@@ -58,15 +61,11 @@ void handle_ouput(void *structure, const vector<vector<double>> &dataset, const
 		clock_t end_ANN = clock();
 		elapsed_secs_ANN += double(end_ANN - start_ANN) / CLOCKS_PER_SEC;
 
-		clock_t start_TNN = clock();
-		tuple<vector<int>, vector<double>> tnn = brute_force(dataset, queries[q], N);
-		clock_t end_TNN = clock();
-		elapsed_secs_TNN += double(end_TNN - start_TNN) / CLOCKS_PER_SEC;
+		elapsed_secs_TNN += truth.times[q];
 		
         vector<int> indices_ann = get<0>(ann);
         vector<double> distances_ann = get<1>(ann);
-        vector<int> indices_tnn = get<0>(tnn);
-        vector<double> distances_tnn = get<1>(tnn);
+        vector<double> distances_tnn = truth.distances[q];
 
 		// Take the average approximate factor from all neighbors.
 		double af = 0;
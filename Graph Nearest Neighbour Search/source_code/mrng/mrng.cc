@@ -115,13 +115,12 @@ tuple<vector<int>, vector<double>> MRNG::query(const vector<double>& q, unsigned
 
 void MRNG::find_neighbors_with_min_distance(int p, unordered_set<int> *Lp)
 {
-	// Use lsh, start with k = 5 and increase k by 5 till we find neighbors with different distances.
-	int k = 5;
+	// Use lsh, start with k = 5 and ask for 5 more neighbors till we find neighbors with different distances.
+	// The buckets are scanned only once, by the iterator.
+	LSHNeighborIterator neighbors_iterator = lsh->query_iterator(dataset[p], distance, true);
 	vector<int> neighbors_indices;
 	vector<double> neighbors_distances;
-	tuple<vector<int>, vector<double>> neighbors = lsh->query(dataset[p], k, distance, true);
-	neighbors_indices = get<0>(neighbors);
-	neighbors_distances = get<1>(neighbors);
+	tie(neighbors_indices, neighbors_distances) = neighbors_iterator.next(5);
 	
 	// In case LSH returns no neighbors, pick a random one.
 	if((int) neighbors_indices.size() == 0){
@@ -129,18 +128,19 @@ void MRNG::find_neighbors_with_min_distance(int p, unordered_set<int> *Lp)
 		// cout << "LSH returned no neighbors, adding a random neighbor instead" << endl;
 
 		int r_index = rand() % dataset.size();
-		while(r_index != p){
+		while(r_index == p){
 			r_index = rand() % dataset.size();
 		}
 		neighbors_indices.push_back(r_index);
 		neighbors_distances.push_back(distance(dataset[p], dataset[r_index]));
 	}
 	else{
-		while (neighbors_distances[0] == (int) neighbors_distances[neighbors_distances.size() - 1]) {
-			k += 5;
-			neighbors = lsh->query(dataset[p], k, distance, true);
-			neighbors_indices = get<0>(neighbors);
-			neighbors_distances = get<1>(neighbors);
+		vector<int> next_indices;
+		vector<double> next_distances;
+		while (neighbors_distances[0] == (int) neighbors_distances[neighbors_distances.size() - 1] && neighbors_iterator.has_next()) {
+			tie(next_indices, next_distances) = neighbors_iterator.next(5);
+			neighbors_indices.insert(neighbors_indices.end(), next_indices.begin(), next_indices.end());
+			neighbors_distances.insert(neighbors_distances.end(), next_distances.begin(), next_distances.end());
 		}
 	}
 	// Add neighbors with same distance to Lp.
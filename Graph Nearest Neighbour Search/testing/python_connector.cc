@@ -21,7 +21,7 @@
 #include "hypercube.hpp"
 #include "lp_metric.hpp"
 
-#include "brute_force.hpp"
+#include "ground_truth.hpp"
 
 using namespace std;
 using std::cout;
@@ -58,6 +58,8 @@ vector<variant<double, int>> helper_arg(void *structure, const vector<vector<dou
 	double maf = 1;
 	int min_neighbors = numeric_limits<int>::max();
 
+	// The exact nearest neighbours are computed once for the dataset and the queries and then loaded from a file.
+	GroundTruth truth = ground_truth(dataset, queries, N);
 	for (int q = 0; q < (int) queries.size(); q++) {
 		cout << "Query: " << q << endl;
 		tuple<vector<int>, vector<double>> ann;
@@ -73,7 +75,7 @@ vector<variant<double, int>> helper_arg(void *structure, const vector<vector<dou
 			ann = ((LSH*) structure)->query(queries[q], N, euclidean_distance, query_trick);
 		}
 		else if (m == 4) {
-			vector<int> q_proj = ((hypercube*) structure)->calculate_q_proj(queries[q]);
+			uint64_t q_proj = ((hypercube*) structure)->calculate_q_proj(queries[q]);
 			ann = ((hypercube*) structure)->query(queries[q], q_proj, N);
 		}
 		else {
@@ -96,12 +98,9 @@ vector<variant<double, int>> helper_arg(void *structure, const vector<vector<dou
 		clock_t end_ANN = clock();
 		elapsed_secs_ANN += double(end_ANN - start_ANN) / CLOCKS_PER_SEC;
 
-		tuple<vector<int>, vector<double>> tnn = brute_force(dataset, queries[q], N);
-		
         vector<int> indices_ann = get<0>(ann);
         vector<double> distances_ann = get<1>(ann);
-        vector<int> indices_tnn = get<0>(tnn);
-        vector<double> distances_tnn = get<1>(tnn);
+        vector<double> distances_tnn = truth.distances[q];
 
 		// Take the minimum approximate factor from all neighbors.
 		int distance_min = distances_ann[0];
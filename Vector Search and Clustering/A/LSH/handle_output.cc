@@ -9,7 +9,7 @@
 #include "lsh.hpp"
 #include "helper.hpp"
 #include "lp_metric.hpp"
-#include "brute_force.hpp"
+#include "ground_truth.hpp"
 
 using namespace std;
 
@@ -22,6 +22,9 @@ using std::set;
 // Writes the results of the queries to output file in the required format.
 void handle_ouput(LSH &lsh, const vector<vector<double>> &dataset, const vector<vector<double>> &queries, int n, double r, ofstream &output)
 {
+	// The exact nearest neighbours are computed once for the dataset and the queries and then loaded from a file.
+	// They are timed one query at a time for tTrue.
+	GroundTruth truth = ground_truth(dataset, queries, n, "euclidean", euclidean_distance, GROUND_TRUTH_DIRECTORY, true);
 	for (int q = 0; q < (int) queries.size(); q++) {
 		cout << "Query: " << q << endl;
 		output << "Query: " << q << endl;
@@ -30,15 +33,11 @@ void handle_ouput(LSH &lsh, const vector<vector<double>> &dataset, const vector<
 		clock_t end_ANN = clock();
 		double elapsed_secs_ANN = double(end_ANN - start_ANN) / CLOCKS_PER_SEC;
 
-		clock_t start_TNN = clock();
-		tuple<vector<int>, vector<double>> tnn = brute_force(dataset, queries[q], n, euclidean_distance);
-		clock_t end_TNN = clock();
-		double elapsed_secs_TNN = double(end_TNN - start_TNN) / CLOCKS_PER_SEC;
+		double elapsed_secs_TNN = truth.times[q];
 		
         vector<int> indices_ann = get<0>(ann);
         vector<double> distances_ann = get<1>(ann);
-        vector<int> indices_tnn = get<0>(tnn);
-        vector<double> distances_tnn = get<1>(tnn);
+        vector<double> distances_tnn = truth.distances[q];
         for(int i = 0; (unsigned int) i < indices_ann.size(); i++){
 			output << "Nearest neighbor-" << i+1 << ": " << indices_ann[i] << endl;
 			output << "distanceLSH: " << distances_ann[i] << endl;
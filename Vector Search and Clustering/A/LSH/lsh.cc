@@ -1,37 +1,238 @@
+#include <iostream>
+#include <fstream>
 #include <vector>
 #include <iterator>
 #include <tuple>
 #include <set>
 #include <unordered_set>
+#include <unordered_map>
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <string>
+#include <stdexcept>
 // iterator is used for std::const_iterator, std::advance().
+// algorithm is used for std::make_heap(), std::pop_heap(), std::upper_bound(), std::stable_sort(), std::max(), std::swap()
+// and functional for std::greater.
+// mutex is used for std::unique_lock and shared_mutex for std::shared_lock.
+// stdexcept is used for std::runtime_error.
 
 #include "lsh.hpp"
 #include "list.hpp"
 #include "hash_table.hpp"
+#include "binary_file.hpp"
 
 using namespace std;
 
+// Every index file starts with this magic number ("LSHI") and the version of its format. The magic number also
+// tells the byte order of the file, as it is read byte-swapped on a machine of the other endianness.
+// Version 2 stores the size of the pool of shared hash functions (and the pool itself) after the dataset size.
+static const unsigned int LSH_INDEX_MAGIC = 0x4C534849;
+static const unsigned int LSH_INDEX_MAGIC_SWAPPED = 0x4948534C;
+static const int LSH_INDEX_VERSION = 2;
+
+// Returns the number of combinations of k out of n, or the given limit if it is larger.
+static long long combinations(int n, int k, long long limit)
+{
+    long long result = 1;
+    for(int i = 1; i <= k; i++){
+        result = result * (n - k + i) / i;
+        if(result >= limit){
+            return limit;
+        }
+    }
+    return result;
+}
+
+// ---------- Functions for class LSHNeighborIterator ---------- //
+
+// Initializes an iterator with the given candidates (distance, index), which must be unique.
+LSHNeighborIterator::LSHNeighborIterator(vector<tuple<double, int>> candidates)
+: heap(candidates)
+{
+    make_heap(heap.begin(), heap.end(), greater<tuple<double, int>>());
+}
+
+// Returns the indices of the next m nearest neighbours and their distances to the query,
+// or fewer if there are not enough candidates left.
+tuple<vector<int>, vector<double>> LSHNeighborIterator::next(unsigned int m)
+{
+    vector<int> indices;
+    vector<double> distances;
+    while(indices.size() < m && !heap.empty()){
+        pop_heap(heap.begin(), heap.end(), greater<tuple<double, int>>());
+        distances.push_back(get<0>(heap.back()));
+        indices.push_back(get<1>(heap.back()));
+        heap.pop_back();
+    }
+    return make_tuple(indices, distances);
+}
+
+// Returns true if there are candidates left.
+bool LSHNeighborIterator::has_next() const
+{
+    return !heap.empty();
+}
+
 // ---------- Functions for class LSH ---------- //
 
 // Initializes an instance with the given number of hash functions,
 // number of hash tables, table size and window.
-// The last argument is the set of points the LSH algorithm will be applied to.
-LSH::LSH(int number_of_hash_functions, int number_of_hash_tables, int table_size, double window, const vector<vector<double>> &dataset)
+// The next argument is the set of points the LSH algorithm will be applied to.
+// If the last argument m is positive, the hash tables share a pool of m >= k hash functions (more if there are
+// fewer than L combinations of k of them), each one using a different combination of k of them,
+// so that hashing a point costs m instead of k * L projections.
+LSH::LSH(int number_of_hash_functions, int number_of_hash_tables, int table_size, double window, const vector<vector<double>> &dataset,
+         int pool_size)
 : number_of_dimensions(dataset.at(0).size()), number_of_hash_functions(number_of_hash_functions),
-  table_size(table_size), number_of_hash_tables(number_of_hash_tables), dataset(dataset)
+  table_size(table_size), number_of_hash_tables(number_of_hash_tables), dataset(dataset),
+  number_of_points(dataset.size()), number_of_tombstones(0), compaction_threshold(0.2), compacting(false)
 {
     hash_tables = new HashTable<vector<double>, int>*[number_of_hash_tables];
-    for(int i = 0; i < number_of_hash_tables; i++){
-        hash_tables[i] = new HashTable<vector<double>, int>(table_size, number_of_dimensions, number_of_hash_functions, window);
+    if(pool_size > 0){
+        // The pool needs at least k hash functions, and enough of them for L different combinations of k.
+        pool_size = max(pool_size, number_of_hash_functions);
+        while(combinations(pool_size, number_of_hash_functions, number_of_hash_tables) < number_of_hash_tables){
+            pool_size++;
+        }
+        for(int i = 0; i < pool_size; i++){
+            hash_function_pool.push_back(new HashFunction(number_of_dimensions, window));
+        }
+
+        // Each table picks k distinct hash functions of the pool at random (partial Fisher-Yates shuffle).
+        // A combination already picked by another table is drawn again, as that table would have the same buckets.
+        vector<int> indices(pool_size);
+        for(int i = 0; i < pool_size; i++){
+            indices[i] = i;
+        }
+        set<vector<int>> picked;
+        for(int i = 0; i < number_of_hash_tables; i++){
+            vector<int> table_indices;
+            do{
+                for(int j = 0; j < number_of_hash_functions; j++){
+                    swap(indices[j], indices[j + rand() % (pool_size - j)]);
+                }
+                table_indices.assign(indices.begin(), indices.begin() + number_of_hash_functions);
+                sort(table_indices.begin(), table_indices.end());
+            }while(!picked.insert(table_indices).second);
+            hash_tables[i] = new HashTable<vector<double>, int>(table_size, table_indices);
+        }
+    }
+    else{
+        for(int i = 0; i < number_of_hash_tables; i++){
+            hash_tables[i] = new HashTable<vector<double>, int>(table_size, number_of_dimensions, number_of_hash_functions, window);
+        }
     }
 
     // Insert data to all hash tables.
     for(int i = 0; (unsigned int) i < dataset.size(); i++){
-        insert(dataset.at(i), i);
+        points.push_back(&dataset.at(i));
+        insert_to_tables(dataset.at(i), i);
+    }
+}
+
+// Initializes an instance from an index file written by save(), without rebuilding the hash tables.
+// The last argument must be the same dataset the index was built on.
+// Throws std::runtime_error if the file is not an index file of the current version, does not match the dataset
+// or is corrupted.
+LSH::LSH(ifstream& file, const vector<vector<double>> &dataset)
+: number_of_dimensions(read_header(file)), number_of_hash_functions(read_int(file)),
+  table_size(read_int(file)), number_of_hash_tables(read_int(file)), dataset(dataset),
+  number_of_points(0), number_of_tombstones(0), compaction_threshold(0.2), compacting(false)
+{
+    int dataset_size = read_int(file);
+    if(!file || dataset.empty() || (unsigned int) dataset_size != dataset.size() || (unsigned int) number_of_dimensions != dataset.at(0).size()){
+        throw runtime_error("LSH index file does not match the given dataset");
+    }
+    // Every table takes at least three integers and one more per bucket chain.
+    streamoff end = end_of_file(file);
+    if(number_of_hash_functions < 1 || table_size < 1 || number_of_hash_tables < 1
+       || (double) number_of_hash_tables * (3 + (double) table_size) * sizeof(int) > (double) (end - file.tellg())){
+        throw runtime_error("LSH index file is corrupted");
+    }
+
+    // The destructor does not run if the constructor throws, so free what has been read so far.
+    hash_tables = new HashTable<vector<double>, int>*[number_of_hash_tables];
+    for(int i = 0; i < number_of_hash_tables; i++){
+        hash_tables[i] = NULL;
+    }
+    try{
+        int pool_size = read_count(file, 2 * sizeof(int) + (number_of_dimensions + 1) * sizeof(double), end);
+        for(int i = 0; i < pool_size; i++){
+            hash_function_pool.push_back(new HashFunction(file, number_of_dimensions));
+        }
+        for(int i = 0; i < number_of_hash_tables; i++){
+            hash_tables[i] = new HashTable<vector<double>, int>(file, end, number_of_dimensions, pool_size);
+        }
+
+        // Restore removed and inserted points. Every id of the dataset is kept, even if it has been removed.
+        int number_of_ids = read_count(file, 1, end);
+        if(number_of_ids < dataset_size){
+            throw runtime_error("LSH index file is corrupted");
+        }
+        vector<char> removed(number_of_ids);
+        file.read(removed.data(), number_of_ids);
+        int number_of_inserted_points = read_count(file, sizeof(int) + number_of_dimensions * sizeof(double), end);
+        for(int i = 0; i < number_of_inserted_points; i++){
+            int id = read_int(file);
+            if(!file || id < 0 || id >= number_of_ids){
+                throw runtime_error("LSH index file is corrupted");
+            }
+            vector<double> p(number_of_dimensions);
+            file.read((char*) p.data(), number_of_dimensions * sizeof(double));
+            inserted_points[id] = p;
+        }
+        if(!file){
+            throw runtime_error("LSH index file is corrupted");
+        }
+
+        // The values of the buckets are ids, which index points.
+        for(int i = 0; i < number_of_hash_tables; i++){
+            bool valid = true;
+            hash_tables[i]->for_each([&valid, number_of_ids](int id){
+                valid = valid && id >= 0 && id < number_of_ids;
+            });
+            if(!valid){
+                throw runtime_error("LSH index file is corrupted");
+            }
+        }
+
+        points.resize(number_of_ids, NULL);
+        for(int id = 0; id < number_of_ids; id++){
+            if(removed.at(id)){
+                number_of_tombstones++;
+            }
+            else if(inserted_points.find(id) != inserted_points.end()){
+                points.at(id) = &inserted_points.at(id);
+                number_of_points++;
+            }
+            else if(id < dataset_size){
+                points.at(id) = &dataset.at(id);
+                number_of_points++;
+            }
+        }
+    }
+    catch(...){
+        free_index();
+        throw;
     }
 }
 
 LSH::~LSH()
+{
+    {
+        lock_guard<std::mutex> guard(compaction_mutex);
+        if(compaction_thread.joinable()){
+            compaction_thread.join();
+        }
+    }
+    free_index();
+}
+
+// Deletes the hash tables and the hash functions of the pool.
+void LSH::free_index()
 {
     for(int i = 0; i < number_of_hash_tables; i++){
         if(hash_tables[i] != NULL){
@@ -39,14 +240,247 @@ LSH::~LSH()
         }
     }
     delete[] hash_tables;
+    for(HashFunction *h : hash_function_pool){
+        delete h;
+    }
+}
+
+// Reads an integer from the given file, used to initialize the constant members when loading.
+int LSH::read_int(ifstream& file)
+{
+    int value = 0;
+    file.read((char*) &value, sizeof(int));
+    return value;
+}
+
+// Checks the magic number and the version at the start of an index file and returns the integer that follows them.
+int LSH::read_header(ifstream& file)
+{
+    unsigned int magic = 0;
+    file.read((char*) &magic, sizeof(unsigned int));
+    if(magic == LSH_INDEX_MAGIC_SWAPPED){
+        throw runtime_error("LSH index file was saved on a machine with a different byte order");
+    }
+    if(!file || magic != LSH_INDEX_MAGIC){
+        throw runtime_error("File is not an LSH index file");
+    }
+    int version = read_int(file);
+    if(version != LSH_INDEX_VERSION){
+        throw runtime_error("LSH index file has format version " + to_string(version) + " instead of "
+                            + to_string(LSH_INDEX_VERSION) + ", it has to be built again");
+    }
+    return read_int(file);
+}
+
+// Saves the index (magic number, format version, parameters, hash functions and bucket contents) to a .bin file.
+void LSH::save(ofstream& file) const
+{
+    shared_lock<shared_mutex> lock(mutex);
+    int dataset_size = dataset.size();
+    file.write((char*) &LSH_INDEX_MAGIC, sizeof(unsigned int));
+    file.write((char*) &LSH_INDEX_VERSION, sizeof(int));
+    file.write((char*) &number_of_dimensions, sizeof(int));
+    file.write((char*) &number_of_hash_functions, sizeof(int));
+    file.write((char*) &table_size, sizeof(int));
+    file.write((char*) &number_of_hash_tables, sizeof(int));
+    file.write((char*) &dataset_size, sizeof(int));
+
+    int pool_size = hash_function_pool.size();
+    file.write((char*) &pool_size, sizeof(int));
+    for(HashFunction *h : hash_function_pool){
+        h->save(file);
+    }
+
+    for(int i = 0; i < number_of_hash_tables; i++){
+        hash_tables[i]->save(file);
+    }
+
+    // Save removed ids and points inserted after initialization, that are not stored in the dataset.
+    int number_of_ids = points.size();
+    vector<char> removed(number_of_ids);
+    for(int id = 0; id < number_of_ids; id++){
+        removed.at(id) = (points.at(id) == NULL);
+    }
+    file.write((char*) &number_of_ids, sizeof(int));
+    file.write(removed.data(), number_of_ids);
+
+    int number_of_inserted_points = 0;
+    for(int id = 0; id < number_of_ids; id++){
+        number_of_inserted_points += (points.at(id) != NULL && (id >= dataset_size || points.at(id) != &dataset.at(id)));
+    }
+    file.write((char*) &number_of_inserted_points, sizeof(int));
+    for(int id = 0; id < number_of_ids; id++){
+        if(points.at(id) != NULL && (id >= dataset_size || points.at(id) != &dataset.at(id))){
+            file.write((char*) &id, sizeof(int));
+            file.write((char*) points.at(id)->data(), number_of_dimensions * sizeof(double));
+        }
+    }
 }
 
 // Inserts the given data point with the given index to all L hash tables. 
-void LSH::insert(vector<double> p, int index)
+void LSH::insert_to_tables(const vector<double>& p, int index)
+{
+    vector<unsigned int> ids = hash_ids(p);
+    for(int i = 0; i < number_of_hash_tables; i++){
+        hash_tables[i]->insert_by_id(ids[i], index);
+    }
+}
+
+// Returns the ID of the given point in each of the L hash tables.
+// With a shared pool, only the m hash functions of the pool are computed.
+vector<unsigned int> LSH::hash_ids(const vector<double>& p) const
 {
+    vector<unsigned int> ids(number_of_hash_tables);
+    if(hash_function_pool.empty()){
+        for(int i = 0; i < number_of_hash_tables; i++){
+            ids[i] = hash_tables[i]->secondary_hash_function(p);
+        }
+        return ids;
+    }
+
+    vector<int> pool_values(hash_function_pool.size());
+    for(int i = 0; i < (int) hash_function_pool.size(); i++){
+        pool_values[i] = hash_function_pool[i]->hash(p);
+    }
     for(int i = 0; i < number_of_hash_tables; i++){
-        hash_tables[i]->insert(p, index);
+        ids[i] = hash_tables[i]->pooled_hash_function(pool_values);
+    }
+    return ids;
+}
+
+// Inserts the given point with the given id to the index and returns true,
+// or returns false if a point with the same id is already in the index.
+// Ids of removed points can be reused.
+bool LSH::insert(int id, const vector<double>& p)
+{
+    unique_lock<shared_mutex> lock(mutex);
+    if(id < 0 || (unsigned int) p.size() != (unsigned int) number_of_dimensions){
+        return false;
+    }
+    if((unsigned int) id < points.size() && points.at(id) != NULL){
+        return false;
+    }
+    if((unsigned int) id >= points.size()){
+        points.resize(id + 1, NULL);
+    }
+    else{
+        reinserted_ids[id]++;
+    }
+
+    // Entries of a removed point with the same id may still be in the hash tables until the next compaction.
+    // They are harmless, since duplicates are ignored by the queries and distances are computed using the new point.
+    inserted_points[id] = p;
+    points.at(id) = &inserted_points.at(id);
+    insert_to_tables(p, id);
+    number_of_points++;
+    return true;
+}
+
+// Removes the point with the given id and returns true, or returns false if there is no such point.
+// The point is only marked as removed (tombstone) and skipped by the queries, until a compaction
+// removes it from the hash tables. If the ratio of tombstones exceeds the compaction threshold,
+// a compaction is started in the background.
+bool LSH::remove(int id)
+{
+    {
+        unique_lock<shared_mutex> lock(mutex);
+        if(id < 0 || (unsigned int) id >= points.size() || points.at(id) == NULL){
+            return false;
+        }
+        points.at(id) = NULL;
+        inserted_points.erase(id);
+        number_of_points--;
+        number_of_tombstones++;
+        if(number_of_tombstones <= compaction_threshold * (number_of_points + number_of_tombstones)){
+            return true;
+        }
+    }
+
+    // Start a background compaction, unless one is already running. The compaction clears compacting when it ends,
+    // possibly before the thread that started it has stored it in compaction_thread, so the handle is only
+    // accessed under compaction_mutex.
+    if(!compacting.exchange(true)){
+        lock_guard<std::mutex> guard(compaction_mutex);
+        if(compaction_thread.joinable()){
+            compaction_thread.join();
+        }
+        compaction_thread = thread([this](){
+            compact();
+            compacting = false;
+        });
+    }
+    return true;
+}
+
+// Removes all tombstones from the hash tables, and the entries of removed points whose ids have been
+// inserted again, which are found by their buckets. Each hash table is locked separately, so queries
+// are only blocked while one table is compacted.
+void LSH::compact()
+{
+    int tombstones;
+    unordered_map<int, int> reinserted;
+    unordered_map<int, vector<unsigned int>> current_ids; // Bucket IDs of the current point of each reinserted id.
+    {
+        shared_lock<shared_mutex> lock(mutex);
+        tombstones = number_of_tombstones;
+        reinserted = reinserted_ids;
+        for(const auto &[id, count] : reinserted){
+            if(points[id] != NULL){
+                current_ids[id] = hash_ids(*points[id]);
+            }
+        }
+    }
+    for(int i = 0; i < number_of_hash_tables; i++){
+        unique_lock<shared_mutex> lock(mutex);
+        unordered_set<int> kept; // Reinserted ids whose entry in their current bucket has been kept.
+        hash_tables[i]->remove_if([&](int id, unsigned int bucket_id){
+            if(points[id] == NULL){
+                return true;
+            }
+            // Ids inserted again during the compaction are left for the next one, as their bucket IDs may have changed.
+            auto current = current_ids.find(id);
+            auto count = reinserted_ids.find(id);
+            if(current == current_ids.end() || count == reinserted_ids.end() || count->second != reinserted.at(id)){
+                return false;
+            }
+            // An entry of a removed point with the same id, or another entry of the current point in the same bucket.
+            return current->second[i] != bucket_id || !kept.insert(id).second;
+        });
+    }
+
+    // Points removed during the compaction may have been left in some tables, so keep them counted.
+    unique_lock<shared_mutex> lock(mutex);
+    number_of_tombstones -= tombstones;
+    for(const auto &[id, count] : reinserted){
+        auto current = reinserted_ids.find(id);
+        if(current != reinserted_ids.end() && current->second == count){
+            reinserted_ids.erase(current);
+        }
+    }
+}
+
+// Sets the ratio of tombstones (to all points in the hash tables) that triggers a background compaction.
+void LSH::set_compaction_threshold(double threshold)
+{
+    unique_lock<shared_mutex> lock(mutex);
+    compaction_threshold = threshold;
+}
+
+// Returns the point with the given id, or NULL if there is no such point.
+const vector<double>* LSH::get_point(int id) const
+{
+    shared_lock<shared_mutex> lock(mutex);
+    if(id < 0 || (unsigned int) id >= points.size()){
+        return NULL;
     }
+    return points.at(id);
+}
+
+// Returns the number of points in the index, excluding the removed ones.
+int LSH::get_number_of_points() const
+{
+    shared_lock<shared_mutex> lock(mutex);
+    return number_of_points;
 }
 
 // Returns the indices of the k-approximate nearest neighbours (ANN) of the given query q
@@ -59,46 +493,29 @@ tuple<vector<int>, vector<double>> LSH::query(const vector<double>& q, unsigned
     auto compare = [](tuple<int, double> t1, tuple<int, double> t2){ return get<1>(t1) < get<1>(t2); };
     multiset<tuple<int, double>, decltype(compare)> s(compare);
     unordered_set<int> unique_indices;
-
-    double dist;
-    int p_index;
-    bool valid = true;
-    unsigned int q_id;
-    unsigned int p_id;
+    shared_lock<shared_mutex> lock(mutex);
+    vector<unsigned int> q_ids = hash_ids(q);
 
     for(int i = 0; i < number_of_hash_tables; i++){
         // Hash query.
-        q_id = hash_tables[i]->secondary_hash_function(q);
+        unsigned int q_id = q_ids[i];
 
-        while(true){
-            tie(p_index, p_id) = hash_tables[i]->get_data(q, valid);
+        // Choose only the points that share the same ID inside the bucket (Querying trick).
+        hash_tables[i]->for_each_in_chain(q_id, [&](int p_index, unsigned int){
+            const vector<double> *p = points[p_index];
 
-            if(p_index == 0 && !valid){
-                break;
-            }
-
-            vector<double> p = dataset.at(p_index);
-
-            // Skip query if found.
-            if(p == q){
-                continue;
-            }
-
-            // Choose only the points that share the same ID inside the bucket (Querying trick).
-            if(querying_trick && p_id != q_id){
-                continue;
+            // Skip removed points, already found points and the query itself.
+            if(p == NULL || unique_indices.find(p_index) != unique_indices.end() || *p == q){
+                return;
             }
 
             // Keep k items only to save space.
-            dist = distance(p, q);
-            if(unique_indices.find(p_index) == unique_indices.end()){
-                s.insert(make_tuple(p_index, dist));
-                unique_indices.insert(p_index);
-            }
+            s.insert(make_tuple(p_index, distance(*p, q)));
+            unique_indices.insert(p_index);
             if(s.size() > k){
                 s.erase(std::prev(s.end(), 1));
             }
-        }
+        }, querying_trick);
     }
 
     vector<int> indices;
@@ -111,6 +528,34 @@ tuple<vector<int>, vector<double>> LSH::query(const vector<double>& q, unsigned
     return make_tuple(indices, distances);
 }
 
+// Returns an iterator over the approximate nearest neighbours of the given query q, in increasing order
+// of distance based on the given distance function. Last parameter indicates whether or not the Querying trick is applied.
+// Unlike query(), the number of neighbours does not have to be known in advance.
+LSHNeighborIterator LSH::query_iterator(const vector<double>& q,
+                                        double (*distance)(const vector<double>&, const vector<double>&),
+                                        bool querying_trick) const
+{
+    vector<tuple<double, int>> candidates;
+    unordered_set<int> unique_indices;
+    shared_lock<shared_mutex> lock(mutex);
+    vector<unsigned int> q_ids = hash_ids(q);
+
+    for(int i = 0; i < number_of_hash_tables; i++){
+        unsigned int q_id = q_ids[i];
+        hash_tables[i]->for_each_in_chain(q_id, [&](int p_index, unsigned int){
+            const vector<double> *p = points[p_index];
+
+            // Skip removed points, already found points and the query itself.
+            if(p == NULL || unique_indices.find(p_index) != unique_indices.end() || *p == q){
+                return;
+            }
+            candidates.push_back(make_tuple(distance(*p, q), p_index));
+            unique_indices.insert(p_index);
+        }, querying_trick);
+    }
+    return LSHNeighborIterator(candidates);
+}
+
 // Returns the indices of the k-approximate nearest neighbours (ANN) of the given query q
 // and their distances to the query based on the given distance function.
 // All the neighbours returned lie within radius r.
@@ -118,40 +563,78 @@ tuple<vector<int>, vector<double>> LSH::query_range(const vector<double>& q, dou
                                                     double (*distance)(const vector<double>&, const vector<double>&),
                                                     bool limit_queries)
 {
-    auto compare = [](tuple<int, double> t1, tuple<int, double> t2){ return get<1>(t1) < get<1>(t2); };
-    multiset<tuple<int, double>, decltype(compare)> s(compare);
-    unordered_set<int> unique_indices;
+    return query_range(q, vector<double>{r}, distance, limit_queries).at(0);
+}
+
+// Returns, for each of the given radii (sorted in increasing order), the indices of the k-approximate nearest neighbours (ANN)
+// of the given query q and their distances to the query based on the given distance function, that lie within this radius
+// but not within any of the previous radii. The buckets are scanned and the distances computed only once for all radii.
+// If limit_queries is set, each radius stops taking points after 20 * L neighbours are found within it.
+vector<tuple<vector<int>, vector<double>>> LSH::query_range(const vector<double>& q, const vector<double>& radii,
+                                                            double (*distance)(const vector<double>&, const vector<double>&),
+                                                            bool limit_queries)
+{
+    vector<vector<tuple<double, int>>> rings(radii.size());
+    if(radii.empty()){
+        return vector<tuple<vector<int>, vector<double>>>();
+    }
+
+    // With limit_queries, every radius stops taking points in a table after 20 * L neighbours within it have been
+    // found, as if it were queried on its own, so that the points of the small radii are not crowded out by the
+    // ones of the large radii. A point goes to the ring of the smallest radius that contains it and still takes points.
+    int number_of_radii = radii.size();
+    unsigned int limit = 20 * number_of_hash_tables;
+    vector<unsigned int> found(number_of_radii, 0); // Number of neighbours within each radius.
+    unordered_map<int, double> scanned;              // Distances of the points scanned so far.
+    unordered_set<int> unique_indices;               // Points added to a ring.
+    shared_lock<shared_mutex> lock(mutex);
+    vector<unsigned int> q_ids = hash_ids(q);
 
-    double dist;
-    int p_index;
-    unsigned int p_id;
-    bool valid = true;
     for(int i = 0; i < number_of_hash_tables; i++){
-        while(true){
-            tie(p_index, p_id) = hash_tables[i]->get_data(q, valid);
+        vector<char> limit_reached(number_of_radii, false);
+        int number_of_limits_reached = 0;
+        unsigned int q_id = q_ids[i];
+        hash_tables[i]->for_each_in_chain(q_id, [&](int p_index, unsigned int){
+            const vector<double> *p = points[p_index];
 
-            if(p_index == 0 && !valid){
-                break;
+            // Skip removed and already found points.
+            if(number_of_limits_reached == number_of_radii || p == NULL || unique_indices.find(p_index) != unique_indices.end()){
+                return;
             }
-            vector<double> p = dataset.at(p_index);
-            dist = distance(p, q);
-            if(dist < r){
-                if(unique_indices.find(p_index) == unique_indices.end()){
-                    s.insert(make_tuple(p_index, dist));
-                    unique_indices.insert(p_index);
+            // A point that no radius could take yet may be taken when it is found again, so its distance is kept.
+            unordered_map<int, double>::const_iterator iter = scanned.find(p_index);
+            double dist = (iter != scanned.end()) ? iter->second : (scanned[p_index] = distance(*p, q));
+
+            // The point lies within the radii from the smallest radius r with dist < r on.
+            int first = upper_bound(radii.begin(), radii.end(), dist) - radii.begin();
+            for(int j = 0; j < number_of_radii; j++){
+                if(limit_reached[j]){
+                    continue;
+                }
+                if(j >= first){
+                    if(unique_indices.insert(p_index).second){
+                        rings.at(j).push_back(make_tuple(dist, p_index));
+                    }
+                    found[j]++;
+                }
+                if(limit_queries && found[j] > limit){ // Optional.
+                    limit_reached[j] = true;
+                    number_of_limits_reached++;
                 }
             }
-            if(limit_queries && s.size() > (unsigned int) 20 * number_of_hash_tables){ // Optional.
-                break;
-            }
-        }
+        });
     }
-    vector<int> indices;
-    vector<double> distances;
-    set<tuple<int, double>>::const_iterator iter;
-    for(iter = s.begin(); iter != s.end(); std::advance(iter, 1)){
-        indices.push_back(get<0>(*iter));
-        distances.push_back(get<1>(*iter));
+
+    vector<tuple<vector<int>, vector<double>>> results;
+    for(vector<tuple<double, int>> &ring : rings){
+        stable_sort(ring.begin(), ring.end(), [](const tuple<double, int> &t1, const tuple<double, int> &t2){ return get<0>(t1) < get<0>(t2); });
+        vector<int> indices;
+        vector<double> distances;
+        for(const tuple<double, int> &t : ring){
+            indices.push_back(get<1>(t));
+            distances.push_back(get<0>(t));
+        }
+        results.push_back(make_tuple(indices, distances));
     }
-    return make_tuple(indices, distances);
+    return results;
 }
\ No newline at end of file
@@ -0,0 +1,297 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+// algorithm is used for std::sort(), std::max(), std::find().
+// cmath is used for pow().
+// cstdlib is used for rand().
+
+#include "lsh_tuner.hpp"
+#include "lsh.hpp"
+#include "hash_function.hpp"
+#include "ground_truth.hpp"
+
+using namespace std;
+
+static const int NUMBER_OF_FUNCTIONS = 64;   // Hash functions used to estimate the collision probabilities.
+static const int NUMBER_OF_RANDOM_POINTS = 500;
+static const int MAX_K = 20;
+static const int MAX_L = 64;
+static const int MAX_EVALUATIONS = 5;         // Configurations that are built and measured.
+static const double WINDOW_FACTORS[] = {0.5, 1, 2, 4, 8}; // Windows relative to the average nearest neighbour distance.
+static const int TABLE_SIZE_DIVISORS[] = {16, 8, 4, 2};   // Table sizes relative to the dataset size.
+
+// Relative costs of visiting an element of a bucket and a bucket of a chain,
+// compared to one coordinate of an inner product or a distance.
+static const double VISIT_COST = 16;
+static const double CHAIN_COST = 2;
+
+// ---------- Functions for class LSHTuner ---------- //
+
+// Initializes a tuner for the given dataset and number of nearest neighbours N.
+// The last two arguments are the queries (points of the dataset are sampled if empty)
+// and the number of queries sampled from them.
+LSHTuner::LSHTuner(const vector<vector<double>> &dataset, unsigned int N,
+                   const vector<vector<double>> &all_queries, unsigned int number_of_queries)
+: dataset(dataset), N(N), average_neighbour_distance(0)
+{
+    const vector<vector<double>> &source = all_queries.empty() ? dataset : all_queries;
+    number_of_queries = min(number_of_queries, (unsigned int) source.size());
+    for(unsigned int i = 0; i < number_of_queries; i++){
+        queries.push_back(source.at(rand() % source.size()));
+    }
+    for(int i = 0; i < NUMBER_OF_RANDOM_POINTS; i++){
+        random_points.push_back(rand() % dataset.size());
+    }
+
+    // Exact nearest neighbours of the sampled queries. They are computed in parallel but not saved,
+    // since the queries are sampled again in every run.
+    GroundTruth truth = ground_truth(dataset, queries, N, "");
+    true_neighbours = truth.indices;
+    int number_of_neighbours = 0;
+    for(const vector<double> &distances : truth.distances){
+        for(double distance : distances){
+            average_neighbour_distance += distance;
+            number_of_neighbours++;
+        }
+    }
+    if(number_of_neighbours > 0){
+        average_neighbour_distance /= number_of_neighbours;
+    }
+}
+
+// Returns the estimated collision probabilities of a single hash function with the given window for every pair
+// of a sampled query and one of its nearest neighbours (first) or one of the random points (second).
+tuple<vector<double>, vector<double>> LSHTuner::collision_probabilities(double window) const
+{
+    int number_of_dimensions = dataset.at(0).size();
+    vector<double> near, far;
+    for(unsigned int q = 0; q < queries.size(); q++){
+        near.resize(near.size() + true_neighbours[q].size(), 0);
+        far.resize(far.size() + random_points.size(), 0);
+    }
+
+    for(int f = 0; f < NUMBER_OF_FUNCTIONS; f++){
+        HashFunction h(number_of_dimensions, window);
+        vector<int> random_hashes;
+        for(int p : random_points){
+            random_hashes.push_back(h.hash(dataset[p]));
+        }
+
+        int near_index = 0, far_index = 0;
+        for(unsigned int q = 0; q < queries.size(); q++){
+            int q_hash = h.hash(queries[q]);
+            for(int p : true_neighbours[q]){
+                near[near_index++] += (h.hash(dataset[p]) == q_hash);
+            }
+            for(int p_hash : random_hashes){
+                far[far_index++] += (p_hash == q_hash);
+            }
+        }
+    }
+
+    for(double &p : near){
+        p /= NUMBER_OF_FUNCTIONS;
+    }
+    for(double &p : far){
+        p /= NUMBER_OF_FUNCTIONS;
+    }
+    return make_tuple(near, far);
+}
+
+// Builds an LSH with the given configuration and sets its recall@N and average query time on the sampled queries.
+void LSHTuner::evaluate(lsh_config &config) const
+{
+    LSH lsh(config.k, config.L, config.table_size, config.window, dataset);
+
+    int found = 0, total = 0;
+    double elapsed_secs = 0;
+    for(unsigned int q = 0; q < queries.size(); q++){
+        clock_t start = clock();
+        vector<int> indices = get<0>(lsh.query(queries[q], N, euclidean_distance));
+        clock_t end = clock();
+        elapsed_secs += double(end - start) / CLOCKS_PER_SEC;
+
+        for(int index : true_neighbours[q]){
+            found += (find(indices.begin(), indices.end(), index) != indices.end());
+            total++;
+        }
+    }
+    config.recall = (total > 0) ? (double) found / total : 0;
+    config.query_time = elapsed_secs / queries.size();
+}
+
+// Returns the cheapest configuration found with recall@N at least the given target, average query time
+// at most the given time (in seconds) and memory at most the given memory (in MB).
+// Non-positive budgets are ignored. If no configuration meets the target, the one with the highest
+// measured recall is returned.
+lsh_config LSHTuner::tune(double target_recall, double max_query_time, double max_memory)
+{
+    double n = dataset.size();
+    double d = dataset.at(0).size();
+
+    // Estimate the cost of every configuration that meets the target recall and the memory budget.
+    vector<tuple<double, lsh_config>> candidates;
+    for(double factor : WINDOW_FACTORS){
+        double window = factor * average_neighbour_distance;
+        vector<double> near, far;
+        tie(near, far) = collision_probabilities(window);
+
+        for(int k = 1; k <= MAX_K; k++){
+            // Collision probability of a pair in one hash table is p^k, since the k hash functions are independent.
+            vector<double> near_k, far_k;
+            for(double p : near){
+                near_k.push_back(pow(p, k));
+            }
+            for(double p : far){
+                far_k.push_back(pow(p, k));
+            }
+
+            // Smallest L for which the estimated recall, i.e. the average probability of a neighbour
+            // to collide with its query in at least one table, meets the target.
+            int L;
+            double recall = 0;
+            for(L = 1; L <= MAX_L; L++){
+                recall = 0;
+                for(double p : near_k){
+                    recall += 1 - pow(1 - p, L);
+                }
+                recall /= near_k.size();
+                if(recall >= target_recall){
+                    break;
+                }
+            }
+            if(L > MAX_L){
+                continue;
+            }
+
+            // Expected number of points visited in the buckets and of unique candidates whose distance is computed.
+            double visited = 0, unique_candidates = 0;
+            for(double p : far_k){
+                visited += L * p;
+                unique_candidates += 1 - pow(1 - p, L);
+            }
+            visited *= n / far_k.size();
+            unique_candidates *= n / far_k.size();
+
+            // Keep only the cheapest table size that fits in the memory budget,
+            // so that different (k, L, w) configurations are measured.
+            bool fits = false;
+            tuple<double, lsh_config> cheapest;
+            for(int divisor : TABLE_SIZE_DIVISORS){
+                lsh_config config;
+                config.k = k;
+                config.L = L;
+                config.window = window;
+                config.table_size = max(1, (int) n / divisor);
+                config.recall = recall;
+                config.memory = L * (n * 48 + config.table_size * 8) / (1 << 20);
+                if(max_memory > 0 && config.memory > max_memory){
+                    continue;
+                }
+                config.query_time = 0;
+
+                double cost = k * L * d                                   // Hashing the query.
+                            + visited * VISIT_COST                        // Visiting the elements of the buckets.
+                            + unique_candidates * d                       // Computing distances.
+                            + L * (n / config.table_size) * CHAIN_COST;   // Skipping the other buckets of the chains.
+                if(!fits || cost < get<0>(cheapest)){
+                    cheapest = make_tuple(cost, config);
+                    fits = true;
+                }
+            }
+            if(fits){
+                candidates.push_back(cheapest);
+            }
+        }
+    }
+    sort(candidates.begin(), candidates.end(), [](const tuple<double, lsh_config> &t1, const tuple<double, lsh_config> &t2){
+        return get<0>(t1) < get<0>(t2);
+    });
+
+    // Build and measure the cheapest configurations, keeping the fastest one that meets the target and the budget.
+    lsh_config best = lsh_config();
+    bool found = false;
+    lsh_config best_recall = lsh_config();
+    best_recall.recall = -1;
+    for(int i = 0; i < (int) candidates.size() && i < MAX_EVALUATIONS; i++){
+        lsh_config config = get<1>(candidates[i]);
+        evaluate(config);
+        cout << "k: " << config.k << ", L: " << config.L << ", w: " << config.window << ", table size: " << config.table_size
+             << ", recall@" << N << ": " << config.recall << ", query time: " << config.query_time << endl;
+
+        if(config.recall >= target_recall && (max_query_time <= 0 || config.query_time <= max_query_time)){
+            if(!found || config.query_time < best.query_time){
+                best = config;
+                found = true;
+            }
+        }
+        if(config.recall > best_recall.recall){
+            best_recall = config;
+        }
+    }
+    if(found){
+        return best;
+    }
+
+    // No configuration met the target, fall back to the most accurate one within the limits of the search.
+    if(best_recall.recall < 0){
+        best_recall.k = MAX_K / 4;
+        best_recall.L = MAX_L / 8;
+        best_recall.window = 4 * average_neighbour_distance;
+        best_recall.table_size = max(1, (int) n / 4);
+        best_recall.memory = best_recall.L * (n * 48 + best_recall.table_size * 8) / (1 << 20);
+        evaluate(best_recall);
+    }
+    return best_recall;
+}
+
+// ---------- Configuration files ---------- //
+
+// Writes the given configuration to a configuration file, using the same keys as `cluster.conf` and a `table_size` key.
+void write_lsh_config(const string &filename, const lsh_config &config)
+{
+    ofstream file(filename);
+    file << "# LSH configuration found by lsh_tune: recall " << config.recall << ", average query time " << config.query_time
+         << " sec, estimated memory " << config.memory << " MB" << endl;
+    file << "number_of_vector_hash_tables: " << config.L << " // L of LSH" << endl;
+    file << "number_of_vector_hash_functions: " << config.k << " // k of LSH" << endl;
+    file << "window: " << config.window << " // window for LSH" << endl;
+    file << "table_size: " << config.table_size << " // hash table size of LSH" << endl;
+}
+
+// Reads the LSH parameters (k, L, table size, window) from the given configuration file.
+// Parameters that are not in the file keep the values of the given configuration.
+lsh_config read_lsh_config(const string &filename, lsh_config config)
+{
+    ifstream file(filename);
+
+    // Read line by line and parse and ignore // comments at begin or end of line.
+    string line;
+    while (getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        if (line.find("//") != string::npos) {
+            line = line.substr(0, line.find("//"));
+        }
+        if (line.find("number_of_vector_hash_functions:") != string::npos) {
+            config.k = stoi(line.substr(line.find(":") + 1));
+        }
+        else if (line.find("number_of_vector_hash_tables:") != string::npos) {
+            config.L = stoi(line.substr(line.find(":") + 1));
+        }
+        else if (line.find("table_size:") != string::npos) {
+            config.table_size = stoi(line.substr(line.find(":") + 1));
+        }
+        else if (line.find("window:") != string::npos) {
+            config.window = stod(line.substr(line.find(":") + 1));
+        }
+    }
+    return config;
+}
\ No newline at end of file
@@ -5,11 +5,13 @@
 #include <cstdlib>
 #include <ctime>
 #include <vector>
+#include <stdexcept>
 // cstring is used for strcmp().
 // cstdlib is used for srand().
 // ctime is used for time().
 
 #include "lsh.hpp"
+#include "lsh_tuner.hpp"
 #include "helper_LSH.hpp"
 #include "helper.hpp"
 
@@ -26,6 +28,10 @@ int main(int argc, char *argv[]) {
 	double w = 1000;
 	int N = 1;
 	double R = 10000;
+	int pool_size = 0;
+	int table_size = 0;
+	string save_index_file;
+	string load_index_file;
 
 	for (int i = 1; i < argc; i++) {
 		if (strcmp(argv[i], "-d") == 0) {
@@ -36,6 +42,20 @@ int main(int argc, char *argv[]) {
 			query_file = argv[i + 1];
 			i++;
 		}
+		else if (strcmp(argv[i], "-c") == 0) {
+			// Configuration file written by lsh_tune; arguments after it override its values.
+			if (!file_exists(argv[i + 1])) {
+				cout << "File " << argv[i + 1] << " does not exist" << endl;
+				exit(1);
+			}
+			lsh_config config = {k, L, table_size, w, 0, 0, 0};
+			config = read_lsh_config(argv[i + 1], config);
+			k = config.k;
+			L = config.L;
+			table_size = config.table_size;
+			w = config.window;
+			i++;
+		}
 		else if (strcmp(argv[i], "-k") == 0) {
 			k = atoi(argv[i + 1]);
 			i++;
@@ -56,8 +76,20 @@ int main(int argc, char *argv[]) {
 			output_file = argv[i + 1];
 			i++;
 		}
+		else if (strcmp(argv[i], "-pool") == 0) {
+			pool_size = atoi(argv[i + 1]);
+			i++;
+		}
+		else if (strcmp(argv[i], "-save") == 0) {
+			save_index_file = argv[i + 1];
+			i++;
+		}
+		else if (strcmp(argv[i], "-load") == 0) {
+			load_index_file = argv[i + 1];
+			i++;
+		}
 		else if (strcmp(argv[i], "-help") == 0) {
-			cout << "Usage: ./lsh -d <input file> -q <query file> -k <int> -M <int> -probes <int> -o <output file> -N <int> -R <double>" << endl;
+			cout << "Usage: ./lsh -d <input file> -q <query file> -c <configuration file> -k <int> -M <int> -probes <int> -o <output file> -N <int> -R <double> -pool <int> -save <save index file> -load <load index file>" << endl;
 			return 0;
 		}
 		else {
@@ -86,13 +118,42 @@ int main(int argc, char *argv[]) {
 		cout << "File " << input_file << " does not exist" << endl;
 		exit(1);
 	}
+	if (!load_index_file.empty() && !file_exists(load_index_file)) {
+		cout << "File " << load_index_file << " does not exist" << endl;
+		exit(1);
+	}
 	vector <vector<double>> dataset = read_mnist_data(input_file);
 
 	cout << "Read MNIST data" << endl;
 
-	LSH lsh(k, L, dataset.size() / 4, w, dataset);
+	LSH *lsh_ptr;
+	if (!load_index_file.empty()) {
+		ifstream index_file(load_index_file, ios::binary);
+		try {
+			lsh_ptr = new LSH(index_file, dataset);
+		}
+		catch (const runtime_error &error) {
+			cout << error.what() << ": " << load_index_file << endl;
+			exit(1);
+		}
+		index_file.close();
+		cout << "Loaded LSH" << endl;
+	}
+	else {
+		if (table_size <= 0) {
+			table_size = dataset.size() / 4;
+		}
+		lsh_ptr = new LSH(k, L, table_size, w, dataset, pool_size);
+		cout << "Created LSH" << endl;
+	}
+	LSH &lsh = *lsh_ptr;
 
-	cout << "Created LSH" << endl;
+	// save LSH index to binary file
+	if (!save_index_file.empty()) {
+		ofstream index_file(save_index_file, ios::binary);
+		lsh.save(index_file);
+		index_file.close();
+	}
 
 	ofstream output(output_file);
 
@@ -126,5 +187,7 @@ int main(int argc, char *argv[]) {
 
 	cout << "Done in " << elapsed_secs << " seconds" << endl;
 
+	delete lsh_ptr;
+
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+// cstring is used for strcmp().
+// cstdlib is used for srand().
+// ctime is used for time().
+
+#include "lsh_tuner.hpp"
+#include "helper.hpp"
+
+using namespace std;
+
+int main(int argc, char *argv[]) {
+	srand(time(NULL));
+
+	string input_file;
+	string query_file;
+	string config_file;
+	int N = 10;
+	int queries_num = 100;
+	double recall = 0.9;
+	double max_time = 0;
+	double max_memory = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-d") == 0) {
+			input_file = argv[i + 1];
+			i++;
+		}
+		else if (strcmp(argv[i], "-q") == 0) {
+			query_file = argv[i + 1];
+			i++;
+		}
+		else if (strcmp(argv[i], "-o") == 0) {
+			config_file = argv[i + 1];
+			i++;
+		}
+		else if (strcmp(argv[i], "-N") == 0) {
+			N = atoi(argv[i + 1]);
+			i++;
+		}
+		else if (strcmp(argv[i], "-queries") == 0) {
+			queries_num = atoi(argv[i + 1]);
+			i++;
+		}
+		else if (strcmp(argv[i], "-recall") == 0) {
+			recall = atof(argv[i + 1]);
+			i++;
+		}
+		else if (strcmp(argv[i], "-time") == 0) {
+			max_time = atof(argv[i + 1]);
+			i++;
+		}
+		else if (strcmp(argv[i], "-memory") == 0) {
+			max_memory = atof(argv[i + 1]);
+			i++;
+		}
+		else if (strcmp(argv[i], "-help") == 0) {
+			cout << "Usage: ./lsh_tune -d <input file> -q <query file, optional> -o <configuration file> -N <int> -queries <int> "
+					"-recall <double> -time <max average query time in seconds, optional> -memory <max memory in MB, optional>" << endl;
+			return 0;
+		}
+		else {
+			cout << "Invalid arguments" << endl;
+			return 1;
+		}
+	}
+
+	if (input_file.empty()) {
+		cout << "Enter input file: ";
+		cin >> input_file;
+	}
+
+	if (config_file.empty()) {
+		cout << "Enter configuration file: ";
+		cin >> config_file;
+	}
+
+	if (!file_exists(input_file)) {
+		cout << "File " << input_file << " does not exist" << endl;
+		exit(1);
+	}
+	if (!query_file.empty() && !file_exists(query_file)) {
+		cout << "File " << query_file << " does not exist" << endl;
+		exit(1);
+	}
+	if (N <= 0 || queries_num <= 0 || recall <= 0 || recall > 1) {
+		cout << "Invalid arguments" << endl;
+		return 1;
+	}
+
+	vector<vector<double>> dataset = read_mnist_data(input_file);
+	vector<vector<double>> queries;
+	if (!query_file.empty()) {
+		queries = read_mnist_data(query_file);
+	}
+
+	cout << "Read MNIST data" << endl;
+
+	LSHTuner tuner(dataset, N, queries, queries_num);
+	lsh_config config = tuner.tune(recall, max_time, max_memory);
+	if (config.recall < recall || (max_time > 0 && config.query_time > max_time)) {
+		cout << "No configuration meets the target, using the most accurate one found" << endl;
+	}
+
+	cout << "k: " << config.k << ", L: " << config.L << ", w: " << config.window << ", table size: " << config.table_size
+		 << ", recall@" << N << ": " << config.recall << ", query time: " << config.query_time << endl;
+
+	write_lsh_config(config_file, config);
+
+	return 0;
+}
\ No newline at end of file
@@ -8,15 +8,20 @@
 
 #include "hypercube.hpp"
 #include "helper.hpp"
-#include "brute_force.hpp"
+#include "ground_truth.hpp"
 
 using namespace std;
 
-void handle_ouput(hypercube &cube, ofstream &output, const vector<vector<double>> &queries, double R, int N)
+void handle_ouput(const hypercube &cube, ofstream &output, const vector<vector<double>> &queries, double R, int N)
 {
+	const vector<vector<double>> &dataset = cube.get_dataset();
+	// The exact nearest neighbours are computed once for the dataset and the queries and then loaded from a file.
+	// Only the euclidean ones are saved, since other distance functions have no name to tell them apart.
+	// They are timed one query at a time for tTrue.
+	string metric = (cube.distance == euclidean_distance) ? "euclidean" : "";
+	GroundTruth truth = ground_truth(dataset, queries, N, metric, cube.distance, GROUND_TRUTH_DIRECTORY, true);
 	for (int q = 0; q < (int) queries.size(); q++) {
-		vector<vector<double>> dataset = cube.get_dataset();
-		vector<int> q_proj = cube.calculate_q_proj(queries[q]);
+		uint64_t q_proj = cube.calculate_q_proj(queries[q]);
 		cout << "Query: " << q << endl;
 		output << "Query: " << q << endl;
 		clock_t start_ANN = clock();
@@ -26,12 +31,8 @@ void handle_ouput(hypercube &cube, ofstream &output, const vector<vector<double>
 		clock_t end_ANN = clock();
 		double elapsed_secs_ANN = double(end_ANN - start_ANN) / CLOCKS_PER_SEC;
 
-		clock_t start_ENN = clock();
-		vector<int> real_nearest_neighbors;
-		vector<double> dist_true;
-		tie(real_nearest_neighbors, dist_true) = brute_force(dataset, queries[q], N, cube.distance);
-		clock_t end_ENN = clock();
-		double elapsed_secs_ENN = double(end_ENN - start_ENN) / CLOCKS_PER_SEC;
+		const vector<double> &dist_true = truth.distances[q];
+		double elapsed_secs_ENN = truth.times[q];
 		
 		for (int i = 0; i < N; i++) {
 			output << "Nearest neighbor-" << i+1 << ": " << n_nearest_neighbors[i] << endl;
@@ -8,4 +8,4 @@
 #include "hypercube.hpp"
 
 // Writes the results of the queries to output file in the required format.
-void handle_ouput(hypercube &cube, std::ofstream &output, const std::vector<std::vector<double>> &queries, double R, int N);
\ No newline at end of file
+void handle_ouput(const hypercube &cube, std::ofstream &output, const std::vector<std::vector<double>> &queries, double R, int N);
\ No newline at end of file
@@ -7,29 +7,144 @@
 #include <random>
 #include <tuple>
 #include <set>
+#include <queue>
+#include <functional>
 
 #include "lp_metric.hpp"
 #include "hypercube.hpp"
 
 using namespace std;
 
-std::vector<std::vector<int>> hypercube::pack(const std::vector<int> &q_proj, int hamming_distance)
+bool hypercube::next_vertex(std::vector<int> &positions) const
 {
-	std::vector<std::vector<int>> result;
-	for (auto it = hash_table->begin(); it != hash_table->end(); it++) { // for every bucket
-		if (it->first.hamming_distance(q_proj, hamming_distance)) {
-			// push every vertex in the bucket to result
-			result.push_back(it->second);
-			remaining_vertices->erase(it->first);
+	// Advance to the next combination of positions.size() out of k bits in lexicographic order.
+	int h = positions.size();
+	for (int i = h - 1; i >= 0; i--) {
+		if (positions[i] < k - h + i) {
+			positions[i]++;
+			for (int j = i + 1; j < h; j++) {
+				positions[j] = positions[j - 1] + 1;
+			}
+			return true;
 		}
 	}
-	return result;
+	// Every vertex at this hamming distance has been visited, move to the next one.
+	if (h == k) {
+		return false;
+	}
+	positions.push_back(0);
+	for (int i = 0; i <= h; i++) {
+		positions[i] = i;
+	}
+	return true;
 }
 
-int hypercube::f(int x, int i) {
-	// If f_map[i] does not contain x, calculate f_i(x) and store it in f_map[i] else return the stored value.
-	if (f_map[i].find(x) == f_map[i].end()) {
-		f_map[i][x] = rand() % 2;
+vector<uint64_t> hypercube::probe_sequence(const vector<double> &q, uint64_t q_proj) const
+{
+	vector<uint64_t> vertices;
+	if (!directed) {
+		// Vertices with hamming distance = 0, 1, 2, ... from q_proj, by flipping the bits at positions.
+		vector<int> positions;
+		do {
+			uint64_t vertex = q_proj;
+			for (int i : positions) {
+				vertex ^= (uint64_t) 1 << i;
+			}
+			vertices.push_back(vertex);
+		} while ((int) vertices.size() < probes && next_vertex(positions));
+		return vertices;
 	}
-	return f_map[i][x];
+
+	// The cost of flipping bit i is the squared distance of h_i's real value for q to the closest window boundary
+	// after which f_i changes (in units of w), or 1 if f_i is the same in both adjacent windows.
+	// With a learned projection, it is the squared distance of q to the hyperplane of bit i.
+	vector<double> costs(k);
+	if (learned_projection != NULL) {
+		costs = learned_projection->project(q);
+		for (double &cost : costs) {
+			cost *= cost;
+		}
+	}
+	else {
+		for (int i = 0; i < k; i++) {
+			double x = hash_functions[i]->project(q);
+			int h = floor(x);
+			double cost = 1;
+			if (h > 0 && f(h - 1, i) != f(h, i)) {
+				cost = x - h;
+			}
+			if (f(h + 1, i) != f(h, i)) {
+				cost = min(cost, h + 1 - x);
+			}
+			costs[i] = cost * cost;
+		}
+	}
+	vector<int> order(k);
+	for (int i = 0; i < k; i++) {
+		order[i] = i;
+	}
+	sort(order.begin(), order.end(), [&costs](int i, int j) { return costs[i] < costs[j]; });
+
+	// Generate the sets of flipped bits in increasing total cost, as in multi-probe LSH. A set is a sorted list
+	// of positions in order and each set is generated once, by shifting (last position + 1) or expanding
+	// (append last position + 1) the set before it.
+	typedef tuple<double, vector<int>> FlipSet;
+	priority_queue<FlipSet, vector<FlipSet>, greater<FlipSet>> heap;
+	vertices.push_back(q_proj);
+	heap.push(make_tuple(costs[order[0]], vector<int>(1, 0)));
+	while ((int) vertices.size() < probes && !heap.empty()) {
+		double cost;
+		vector<int> set;
+		tie(cost, set) = heap.top();
+		heap.pop();
+
+		uint64_t vertex = q_proj;
+		for (int j : set) {
+			vertex ^= (uint64_t) 1 << order[j];
+		}
+		vertices.push_back(vertex);
+
+		int last = set.back();
+		if (last + 1 < k) {
+			vector<int> shifted = set;
+			shifted.back() = last + 1;
+			heap.push(make_tuple(cost - costs[order[last]] + costs[order[last + 1]], shifted));
+			set.push_back(last + 1);
+			heap.push(make_tuple(cost + costs[order[last + 1]], set));
+		}
+	}
+	return vertices;
+}
+
+size_t hypercube::slot(uint64_t vertex) const
+{
+	// Fibonacci hashing, the table size is a power of 2.
+	uint64_t hash = vertex * 0x9E3779B97F4A7C15ULL;
+	return (hash ^ (hash >> 32)) & (slot_vertices.size() - 1);
+}
+
+void hypercube::find_vertex(uint64_t vertex, int &begin, int &end) const
+{
+	if (direct) {
+		begin = offsets[vertex];
+		end = offsets[vertex + 1];
+		return;
+	}
+	// Linear probing until the vertex or an empty slot is found.
+	size_t i = slot(vertex);
+	while (slot_begins[i] != slot_ends[i] && slot_vertices[i] != vertex) {
+		i = (i + 1) & (slot_vertices.size() - 1);
+	}
+	begin = slot_begins[i];
+	end = slot_ends[i];
+}
+
+int hypercube::f(int x, int i) const {
+	// Mix x with the seed of f_i (splitmix64 finalizer) and use the lowest bit of the result,
+	// so that f_i needs no state and can be used by concurrent queries.
+	uint64_t z = (uint64_t) x + f_seeds[i];
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	z = z ^ (z >> 31);
+	return z & 1;
 }
\ No newline at end of file
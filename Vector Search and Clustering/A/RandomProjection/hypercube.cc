@@ -3,6 +3,7 @@
 #include <vector>
 #include <limits>
 #include <algorithm>
+#include <cstdlib>
 
 #include "lp_metric.hpp"
 #include "hypercube.hpp"
@@ -10,44 +11,110 @@
 using namespace std;
 
 hypercube::hypercube(const vector<vector<double>> &p, int k, int M, int probes, double w,
-					 double (*distance)(const std::vector<double> &, const std::vector<double> &)) : p(p)
+					 double (*distance)(const std::vector<double> &, const std::vector<double> &), bool learned) : p(p)
 {
 	this->k = k;
 	this->M = M;
 	this->probes = probes;
+	this->directed = false;
+	this->distance = distance;
+
+	if (k < 1 || k > 64) {
+		cerr << "The number of dimensions k of the hypercube must be between 1 and 64" << endl;
+		exit(1);
+	}
+
+	learned_projection = NULL;
+	if (learned) {
+		if (k > (int) p[0].size()) {
+			cerr << "The number of dimensions k of a learned hypercube projection must be at most the dimension of the data" << endl;
+			exit(1);
+		}
+		learned_projection = new LearnedProjection(p, k);
+	}
+	else {
+		// Initialize h_i functions, i = 1, ..., k.
+		HashFunction *h;
+		for (int i = 0; i < k; i++) {
+			h = new HashFunction(p[0].size(), w);
+			hash_functions.push_back(h);
+		}
+
+		// Initialize the seeds of f_i, so that f_i(j) is the same for specific j but could be different for different i.
+		for (int i = 0; i < k; i++) {
+			f_seeds.push_back(((uint64_t) rand() << 32) ^ rand());
+		}
+	}
+
+	group_points();
+}
+
+hypercube::hypercube(const vector<vector<double>> &p, int M, int probes, const LearnedProjection &projection,
+					 double (*distance)(const std::vector<double> &, const std::vector<double> &)) : p(p)
+{
+	this->k = projection.get_k();
+	this->M = M;
+	this->probes = probes;
+	this->directed = false;
 	this->distance = distance;
-		
-	// Initialize h_i functions, i = 1, ..., k.
-    HashFunction *h;
-    for(int i = 0; i < k; i++){
-        h = new HashFunction(p[0].size(), w);
-        hash_functions.push_back(h);
-    }
-
-	// Initialize used_vertices.
-	remaining_vertices = new unordered_set<binary_string, binary_string::hash>();
-	// Initialize f_map so that that f_i(j) is calculated only once for specific j but could be different for different i.
-	f_map = new unordered_map<int, int>[k];
-
-	// Initialize HashTable.
-	hash_table = new HashTable();
-	// For each point p, calculate h_i(p) and store p -> [f-i(h_i(p))] for i = 1, ..., d'=k in hash_table.
+	learned_projection = new LearnedProjection(projection);
+	group_points();
+}
+
+void hypercube::group_points()
+{
+	// Calculate the vertex of every point p, i.e. [f_i(h_i(p))] for i = 1, ..., d'=k.
+	vector<uint64_t> vertices(p.size());
 	for (int i = 0; i < (int) p.size(); i++) {
-		vector<int> p_proj;
-		for (int j = 0; j < k; j++) {
-			int h_j = hash_functions[j]->hash(p[i]);
-			p_proj.push_back(f(h_j, j));
+		vertices[i] = calculate_q_proj(p[i]);
+	}
+
+	// Group the indices of the points by vertex.
+	points.resize(p.size());
+	direct = k <= MAX_DIRECT_K && ((size_t) 1 << k) <= MAX_DIRECT_VERTICES_PER_POINT * max(p.size(), (size_t) 1);
+	if (direct) {
+		// Counting sort of the points by vertex, offsets is indexed directly by the vertex.
+		offsets.assign(((size_t) 1 << k) + 1, 0);
+		for (uint64_t vertex : vertices) {
+			offsets[vertex + 1]++;
+		}
+		for (size_t v = 1; v < offsets.size(); v++) {
+			offsets[v] += offsets[v - 1];
+		}
+		vector<int> next(offsets.begin(), offsets.end() - 1);
+		for (int i = 0; i < (int) p.size(); i++) {
+			points[next[vertices[i]]++] = i;
 		}
-		binary_string bs(p_proj); // Convert p_proj to binary string type.
-		auto it = hash_table->find(bs); // Check if bs exists in hash_table.
-		remaining_vertices->insert(bs); // Add bs to used_vertices.
-		if (it != hash_table->end()) { // If it exists, add i to bucket of bs.
-			it->second.push_back(i);
+	}
+	else {
+		// Sort the points by vertex and insert every occupied vertex into the open addressing table.
+		for (int i = 0; i < (int) p.size(); i++) {
+			points[i] = i;
+		}
+		stable_sort(points.begin(), points.end(), [&vertices](int i, int j) { return vertices[i] < vertices[j]; });
+
+		size_t capacity = 1;
+		while (capacity < 2 * p.size()) {
+			capacity *= 2;
 		}
-		else { // If not, create new bucket.
-			vector<int> v;
-			v.push_back(i);
-			hash_table->insert(pair<binary_string, vector<int>>(bs, v));
+		slot_vertices.assign(capacity, 0);
+		slot_begins.assign(capacity, 0);
+		slot_ends.assign(capacity, 0);
+		int begin = 0;
+		while (begin < (int) points.size()) {
+			uint64_t vertex = vertices[points[begin]];
+			int end = begin;
+			while (end < (int) points.size() && vertices[points[end]] == vertex) {
+				end++;
+			}
+			size_t i = slot(vertex);
+			while (slot_begins[i] != slot_ends[i]) {
+				i = (i + 1) & (capacity - 1);
+			}
+			slot_vertices[i] = vertex;
+			slot_begins[i] = begin;
+			slot_ends[i] = end;
+			begin = end;
 		}
 	}
 }
@@ -56,56 +123,41 @@ hypercube::~hypercube() {
 	for (int i = 0; i < (int) hash_functions.size(); i++) {
 		delete hash_functions[i];
 	}	
-	delete[] f_map;
-	delete hash_table;
-	delete remaining_vertices;
+	delete learned_projection;
 }
 
-tuple<vector<int>, vector<double>> hypercube::query(const vector<double> &q, const vector<int> &q_proj, int N) {
+tuple<vector<int>, vector<double>> hypercube::query(const vector<double> &q, uint64_t q_proj, int N) const {
 	int num_points = 0;
-	int num_vertices = 0;
 	
 	// Initialize N best candidates and distances.
 	vector<int> best_candidates(N);
 	vector<double> best_distances(N, numeric_limits<double>::max());
 
-	// deep copy of used_vertices
-	unordered_set<binary_string, binary_string::hash> *used_vertices_copy = new unordered_set<binary_string, binary_string::hash>(*remaining_vertices);
-
-	int hamming_distance = 0;
-	while (true) {
-		// Create all permutations of q_proj with hamming_distance = 0, 1, 2, ...
-		if (remaining_vertices->empty()) {
-			break;
-		}
-		vector<vector<int>> vertices = pack(q_proj, hamming_distance);
-		for (int i = 0; i < (int) vertices.size(); i++) {
-			for (int j = 0; j < (int)vertices[i].size(); j++)
-			{
-				if (num_points >= M)
-					goto check;
-				double dist = distance(p[vertices[i][j]], q);
-				if (dist < best_distances[N - 1]) {
-					best_distances[N - 1] = dist;
-					best_candidates[N - 1] = vertices[i][j];
-					// Sort best_distances and best_candidates.
-					for (int k = N - 1; k > 0; k--) { // Insertion sort (N is small).
-						if (best_distances[k] < best_distances[k - 1]) {
-							swap(best_distances[k], best_distances[k - 1]);
-							swap(best_candidates[k], best_candidates[k - 1]);
-						}
-						else {
-							break;
-						}
+	// Visit at most probes vertices, in the order of the probing strategy.
+	for (uint64_t vertex : probe_sequence(q, q_proj)) {
+		int begin, end;
+		find_vertex(vertex, begin, end);
+		for (int j = begin; j < end; j++)
+		{
+			if (num_points >= M)
+				goto check;
+			double dist = distance(p[points[j]], q);
+			if (dist < best_distances[N - 1]) {
+				best_distances[N - 1] = dist;
+				best_candidates[N - 1] = points[j];
+				// Sort best_distances and best_candidates.
+				for (int k = N - 1; k > 0; k--) { // Insertion sort (N is small).
+					if (best_distances[k] < best_distances[k - 1]) {
+						swap(best_distances[k], best_distances[k - 1]);
+						swap(best_candidates[k], best_candidates[k - 1]);
+					}
+					else {
+						break;
 					}
 				}
-				num_points++;
 			}
-			num_vertices++;
-			if (num_vertices >= probes)
-				goto check;
+			num_points++;
 		}
-		hamming_distance++;
 	}
 
 	check:
@@ -116,45 +168,29 @@ tuple<vector<int>, vector<double>> hypercube::query(const vector<double> &q, con
 			nearest_neighbors.push_back(best_candidates[i]);
 			dist.push_back(best_distances[i]);
 		}
-		// Restore used_vertices.
-		*remaining_vertices = *used_vertices_copy;
-		delete used_vertices_copy;
-
 		return make_tuple(nearest_neighbors, dist);
 }
 
-tuple<vector<int>, vector<double>> hypercube::query_range(const vector<double> &q, const vector<int> &q_proj, double R) {
+tuple<vector<int>, vector<double>> hypercube::query_range(const vector<double> &q, uint64_t q_proj, double R) const {
 	int num_points = 0;
-	int num_vertices = 0;
 
 	multimap<double, int> candidates; // Used multimap to sort candidates by distance and keep duplicates.
 
-	// deep copy of used_vertices
-	unordered_set<binary_string, binary_string::hash> *used_vertices_copy = new unordered_set<binary_string, binary_string::hash>(*remaining_vertices);
-
-	int hamming_distance = 0;
-	while (true) {
-		// Create all permutations of q_proj with hamming_distance = 0, 1, 2, ...
-		if (remaining_vertices->empty()) {
-			break;
-		}
-		vector<vector<int>> vertices = pack(q_proj, hamming_distance);
-		for (int i = 0; i < (int) vertices.size(); i++) {
-			for (int j = 0; j < (int)vertices[i].size(); j++)
+	// Visit at most probes vertices, in the order of the probing strategy.
+	for (uint64_t vertex : probe_sequence(q, q_proj)) {
+		int begin, end;
+		find_vertex(vertex, begin, end);
+		for (int j = begin; j < end; j++)
+		{
+			if (num_points >= M)
+				goto check;
+			double dist = distance(p[points[j]], q);
+			if (dist < R)
 			{
-				if (num_points >= M)
-					goto check;
-				if (distance(p[vertices[i][j]], q) < R)
-				{
-					candidates.insert(pair<double, int>(distance(p[vertices[i][j]], q), vertices[i][j]));
-				}
-				num_points++;
+				candidates.insert(pair<double, int>(dist, points[j]));
 			}
-			num_vertices++;
-			if (num_vertices >= probes)
-				goto check;
+			num_points++;
 		}
-		hamming_distance++;
 	}
 
 	check:
@@ -165,17 +201,52 @@ tuple<vector<int>, vector<double>> hypercube::query_range(const vector<double> &
 			range.push_back(it->second);
 			dist.push_back(it->first);
 		}
-		// Restore used_vertices.
-		*remaining_vertices = *used_vertices_copy;
-		delete used_vertices_copy;
-
 		return make_tuple(range, dist);
 }
 
-vector<int> hypercube::calculate_q_proj(const vector<double> &q) {
-	vector<int> q_proj;
+vector<tuple<vector<int>, vector<double>>> hypercube::query_range(const vector<double> &q, uint64_t q_proj, const vector<double> &radii) const {
+	vector<multimap<double, int>> rings(radii.size());
+	int num_points = 0;
+
+	// Visit the same vertices and candidates as for a single radius, computing each distance once.
+	for (uint64_t vertex : probe_sequence(q, q_proj)) {
+		int begin, end;
+		find_vertex(vertex, begin, end);
+		for (int j = begin; j < end; j++)
+		{
+			if (num_points >= M)
+				goto check;
+			double dist = distance(p[points[j]], q);
+			// Add the point to the ring of the smallest radius r with dist < r.
+			vector<double>::const_iterator radius = upper_bound(radii.begin(), radii.end(), dist);
+			if (radius != radii.end()) {
+				rings[radius - radii.begin()].insert(pair<double, int>(dist, points[j]));
+			}
+			num_points++;
+		}
+	}
+
+	check:
+		vector<tuple<vector<int>, vector<double>>> results;
+		for (const multimap<double, int> &ring : rings) {
+			vector<int> range;
+			vector<double> dist;
+			for (auto it = ring.begin(); it != ring.end(); it++) {
+				range.push_back(it->second);
+				dist.push_back(it->first);
+			}
+			results.push_back(make_tuple(range, dist));
+		}
+		return results;
+}
+
+uint64_t hypercube::calculate_q_proj(const vector<double> &q) const {
+	if (learned_projection != NULL) {
+		return learned_projection->hash(q);
+	}
+	uint64_t q_proj = 0;
 	for (int i = 0; i < k; i++) {
-		q_proj.push_back(f(hash_functions[i]->hash(q), i));
+		q_proj |= (uint64_t) f(hash_functions[i]->hash(q), i) << i;
 	}
 	return q_proj;
 }
\ No newline at end of file
@@ -0,0 +1,250 @@
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <numeric>
+#include <algorithm>
+
+#include "learned_projection.hpp"
+
+using namespace std;
+
+static const int PCA_ITERATIONS = 50; // Iterations of the subspace iteration that finds the principal components.
+
+// Returns the eigenvalues and the eigenvectors (as columns) of the given symmetric matrix (cyclic Jacobi method).
+static void symmetric_eigen(vector<vector<double>> A, vector<double> &values, vector<vector<double>> &vectors)
+{
+	int n = A.size();
+	vectors.assign(n, vector<double>(n, 0));
+	for (int i = 0; i < n; i++) {
+		vectors[i][i] = 1;
+	}
+	for (int sweep = 0; sweep < 100; sweep++) {
+		double off = 0;
+		for (int i = 0; i < n; i++) {
+			for (int j = i + 1; j < n; j++) {
+				off += A[i][j] * A[i][j];
+			}
+		}
+		if (off < 1e-22) {
+			break;
+		}
+		for (int p = 0; p < n; p++) {
+			for (int q = p + 1; q < n; q++) {
+				if (fabs(A[p][q]) < 1e-300) {
+					continue;
+				}
+				// Rotation that zeroes A[p][q].
+				double theta = (A[q][q] - A[p][p]) / (2 * A[p][q]);
+				double t = (theta >= 0 ? 1 : -1) / (fabs(theta) + sqrt(theta * theta + 1));
+				double c = 1 / sqrt(t * t + 1), s = t * c;
+				for (int r = 0; r < n; r++) {
+					double arp = A[r][p], arq = A[r][q];
+					A[r][p] = c * arp - s * arq;
+					A[r][q] = s * arp + c * arq;
+				}
+				for (int r = 0; r < n; r++) {
+					double apr = A[p][r], aqr = A[q][r];
+					A[p][r] = c * apr - s * aqr;
+					A[q][r] = s * apr + c * aqr;
+				}
+				for (int r = 0; r < n; r++) {
+					double vrp = vectors[r][p], vrq = vectors[r][q];
+					vectors[r][p] = c * vrp - s * vrq;
+					vectors[r][q] = s * vrp + c * vrq;
+				}
+			}
+		}
+	}
+	values.resize(n);
+	for (int i = 0; i < n; i++) {
+		values[i] = A[i][i];
+	}
+}
+
+vector<vector<double>> LearnedProjection::orthonormalize(vector<vector<double>> vectors)
+{
+	for (int i = 0; i < (int) vectors.size(); i++) {
+		for (int j = 0; j < i; j++) {
+			double dot = inner_product(vectors[i].begin(), vectors[i].end(), vectors[j].begin(), 0.0);
+			for (int r = 0; r < (int) vectors[i].size(); r++) {
+				vectors[i][r] -= dot * vectors[j][r];
+			}
+		}
+		double norm = sqrt(inner_product(vectors[i].begin(), vectors[i].end(), vectors[i].begin(), 0.0));
+		for (double &x : vectors[i]) {
+			x /= (norm > 0) ? norm : 1;
+		}
+	}
+	return vectors;
+}
+
+LearnedProjection::LearnedProjection(const vector<vector<double>> &p, int k, int iterations, int max_samples) : k(k)
+{
+	int d = p[0].size();
+
+	// Sample the training points.
+	vector<int> sample;
+	if ((int) p.size() <= max_samples) {
+		for (int i = 0; i < (int) p.size(); i++) {
+			sample.push_back(i);
+		}
+	}
+	else {
+		for (int i = 0; i < max_samples; i++) {
+			sample.push_back(rand() % p.size());
+		}
+	}
+	int n = sample.size();
+
+	mean.assign(d, 0);
+	for (int i : sample) {
+		for (int r = 0; r < d; r++) {
+			mean[r] += p[i][r];
+		}
+	}
+	for (double &value : mean) {
+		value /= n;
+	}
+
+	// Covariance matrix of the sample (upper triangle, then mirrored).
+	vector<vector<double>> C(d, vector<double>(d, 0));
+	vector<double> x(d);
+	for (int i : sample) {
+		for (int r = 0; r < d; r++) {
+			x[r] = p[i][r] - mean[r];
+		}
+		for (int r = 0; r < d; r++) {
+			if (x[r] == 0) {
+				continue;
+			}
+			for (int c = r; c < d; c++) {
+				C[r][c] += x[r] * x[c];
+			}
+		}
+	}
+	for (int r = 0; r < d; r++) {
+		for (int c = r; c < d; c++) {
+			C[r][c] /= n;
+			C[c][r] = C[r][c];
+		}
+	}
+
+	// PCA: the first k principal components span the dominant k-dimensional subspace of C, found by
+	// subspace iteration. ITQ rotates them anyway, so any orthonormal basis of the subspace will do.
+	std::default_random_engine random_engine(rand());
+	std::normal_distribution<double> normal(0.0, 1.0);
+	vector<vector<double>> Q(k, vector<double>(d));
+	for (vector<double> &q : Q) {
+		for (double &value : q) {
+			value = normal(random_engine);
+		}
+	}
+	Q = orthonormalize(Q);
+	for (int it = 0; it < PCA_ITERATIONS; it++) {
+		vector<vector<double>> Z(k, vector<double>(d, 0));
+		for (int i = 0; i < k; i++) {
+			for (int r = 0; r < d; r++) {
+				Z[i][r] = inner_product(C[r].begin(), C[r].end(), Q[i].begin(), 0.0);
+			}
+		}
+		Q = orthonormalize(Z);
+	}
+
+	// V = centered sample projected to the principal components (n x k).
+	vector<vector<double>> V(n, vector<double>(k));
+	for (int s = 0; s < n; s++) {
+		for (int r = 0; r < d; r++) {
+			x[r] = p[sample[s]][r] - mean[r];
+		}
+		for (int i = 0; i < k; i++) {
+			V[s][i] = inner_product(x.begin(), x.end(), Q[i].begin(), 0.0);
+		}
+	}
+
+	// ITQ: start from a random rotation R (k x k) and alternate between B = sign(V R) and
+	// the rotation R that minimizes ||B - V R||, i.e. the polar factor of A = V^T B.
+	vector<vector<double>> R(k, vector<double>(k));
+	for (vector<double> &row : R) {
+		for (double &value : row) {
+			value = normal(random_engine);
+		}
+	}
+	R = orthonormalize(R);
+	for (int it = 0; it < iterations; it++) {
+		vector<vector<double>> A(k, vector<double>(k, 0));
+		for (int s = 0; s < n; s++) {
+			for (int j = 0; j < k; j++) {
+				double value = 0;
+				for (int i = 0; i < k; i++) {
+					value += V[s][i] * R[i][j];
+				}
+				double b = (value > 0) ? 1 : -1;
+				for (int i = 0; i < k; i++) {
+					A[i][j] += V[s][i] * b;
+				}
+			}
+		}
+
+		// R = A (A^T A)^{-1/2}.
+		vector<vector<double>> AtA(k, vector<double>(k, 0));
+		for (int i = 0; i < k; i++) {
+			for (int j = 0; j < k; j++) {
+				for (int r = 0; r < k; r++) {
+					AtA[i][j] += A[r][i] * A[r][j];
+				}
+			}
+		}
+		vector<double> values;
+		vector<vector<double>> vectors;
+		symmetric_eigen(AtA, values, vectors);
+		vector<vector<double>> inverse_sqrt(k, vector<double>(k, 0));
+		for (int e = 0; e < k; e++) {
+			double factor = 1 / sqrt(max(values[e], 1e-12));
+			for (int i = 0; i < k; i++) {
+				for (int j = 0; j < k; j++) {
+					inverse_sqrt[i][j] += factor * vectors[i][e] * vectors[j][e];
+				}
+			}
+		}
+		for (int i = 0; i < k; i++) {
+			for (int j = 0; j < k; j++) {
+				R[i][j] = 0;
+				for (int r = 0; r < k; r++) {
+					R[i][j] += A[i][r] * inverse_sqrt[r][j];
+				}
+			}
+		}
+	}
+
+	// W = Q R, column j of R gives the direction of bit j.
+	W.assign(k, vector<double>(d, 0));
+	for (int j = 0; j < k; j++) {
+		for (int i = 0; i < k; i++) {
+			for (int r = 0; r < d; r++) {
+				W[j][r] += R[i][j] * Q[i][r];
+			}
+		}
+	}
+}
+
+vector<double> LearnedProjection::project(const vector<double> &q) const
+{
+	vector<double> values(k, 0);
+	for (int j = 0; j < k; j++) {
+		for (int r = 0; r < (int) q.size(); r++) {
+			values[j] += (q[r] - mean[r]) * W[j][r];
+		}
+	}
+	return values;
+}
+
+uint64_t LearnedProjection::hash(const vector<double> &q) const
+{
+	vector<double> values = project(q);
+	uint64_t vertex = 0;
+	for (int j = 0; j < k; j++) {
+		vertex |= (uint64_t) (values[j] > 0) << j;
+	}
+	return vertex;
+}
\ No newline at end of file
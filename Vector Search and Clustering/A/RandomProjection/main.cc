@@ -20,10 +20,12 @@ int main(int argc, char *argv[]) {
 	string output_file;
 	int k = 14;
 	int M = 10;
-	int probes = 2;
+	int probes = 500;
 	double w = 1000;
 	int N = 1;
 	double R = 10000;
+	bool directed = false;
+	bool learned = false;
 
 	for (int i = 1; i < argc; i++) {
 		if (strcmp(argv[i], "-d") == 0) {
@@ -58,8 +60,14 @@ int main(int argc, char *argv[]) {
 			output_file = argv[i + 1];
 			i++;
 		}
+		else if (strcmp(argv[i], "-directed") == 0) {
+			directed = true;
+		}
+		else if (strcmp(argv[i], "-learned") == 0) {
+			learned = true;
+		}
 		else if (strcmp(argv[i], "-help") == 0) {
-			cout << "Usage: ./lsh -d <input file> -q <query file> -k <int> -M <int> -probes <int> -o <output file> -N <int> -R <double>" << endl;
+			cout << "Usage: ./lsh -d <input file> -q <query file> -k <int> -M <int> -probes <int> -o <output file> -N <int> -R <double> -directed -learned" << endl;
 			return 0;
 		}
 		else {
@@ -90,7 +98,8 @@ int main(int argc, char *argv[]) {
 	}
 	vector <vector<double>> dataset = read_mnist_data(input_file);
 
-	hypercube cube(dataset, k, M, probes, w);
+	hypercube cube(dataset, k, M, probes, w, euclidean_distance, learned);
+	cube.set_directed_probing(directed);
 
 	ofstream output(output_file);
 
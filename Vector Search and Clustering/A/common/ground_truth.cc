@@ -0,0 +1,170 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <tuple>
+#include <algorithm>
+#include <random>
+#include <filesystem>
+#include <unistd.h>
+// chrono is used for the time of each query.
+// filesystem is used for creating the directory of the ground truth files.
+// unistd.h is used for getpid().
+
+#include "ground_truth.hpp"
+#include "vp_tree.hpp"
+
+using namespace std;
+
+// Returns the 64-bit FNV-1a checksum of the given vectors.
+static uint64_t checksum(const vector<vector<double>> &vectors)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    auto add = [&hash](const void *data, size_t size){
+        const unsigned char *bytes = (const unsigned char*) data;
+        for(size_t i = 0; i < size; i++){
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        }
+    };
+    uint64_t size = vectors.size();
+    add(&size, sizeof(uint64_t));
+    for(const vector<double> &v : vectors){
+        size = v.size();
+        add(&size, sizeof(uint64_t));
+        add(v.data(), v.size() * sizeof(double));
+    }
+    return hash;
+}
+
+// Reads the ground truth of the given queries from the given file written by save_ground_truth().
+// Returns false if the file does not exist, is incomplete or has extra bytes, or does not fit the dataset and K.
+static bool load_ground_truth(const string &filename, const vector<vector<double>> &dataset,
+                              const vector<vector<double>> &queries, unsigned int K, GroundTruth &truth)
+{
+    ifstream file(filename, ios::binary);
+    if(!file){
+        return false;
+    }
+    // Each query is stored like a row of an .ivecs file: the number of neighbours followed by their indices,
+    // and then their distances and the time it took to find them, which is negative if it was not measured.
+    truth = GroundTruth();
+    int n = dataset.size();
+    int expected = min((size_t) K, dataset.size());
+    for(const vector<double> &q : queries){
+        int count;
+        if(!file.read((char*) &count, sizeof(int)) || count < 0 || count > expected){
+            return false;
+        }
+        // Points equal to the query are skipped, so only a query of the dataset may have fewer neighbours.
+        if(count < expected && count != min(expected, n - (int) std::count(dataset.begin(), dataset.end(), q))){
+            return false;
+        }
+        vector<int> indices(count);
+        vector<double> distances(count);
+        double time;
+        file.read((char*) indices.data(), count * sizeof(int));
+        file.read((char*) distances.data(), count * sizeof(double));
+        file.read((char*) &time, sizeof(double));
+        if(!file){
+            return false;
+        }
+        for(int index : indices){
+            if(index < 0 || index >= n){
+                return false;
+            }
+        }
+        truth.indices.push_back(indices);
+        truth.distances.push_back(distances);
+        truth.times.push_back(time);
+    }
+    return file.peek() == ifstream::traits_type::eof();
+}
+
+// Writes the given ground truth to the given file.
+static void save_ground_truth(const string &filename, const GroundTruth &truth)
+{
+    // Write to a temporary file first, so that a concurrent run never reads an incomplete file.
+    // Its name has the process ID and a random suffix, so that concurrent runs never write to the same one.
+    string temporary = filename + ".tmp" + to_string(getpid()) + "_" + to_string(random_device()());
+    ofstream file(temporary, ios::binary);
+    for(unsigned int q = 0; q < truth.indices.size(); q++){
+        int count = truth.indices[q].size();
+        file.write((char*) &count, sizeof(int));
+        file.write((char*) truth.indices[q].data(), count * sizeof(int));
+        file.write((char*) truth.distances[q].data(), count * sizeof(double));
+        file.write((char*) &truth.times[q], sizeof(double));
+    }
+    file.close();
+    error_code error;
+    filesystem::rename(temporary, filename, error);
+    if(error){
+        cerr << "Could not save ground truth file " << filename << endl;
+        filesystem::remove(temporary, error);
+    }
+}
+
+// Sets the ground truth of every query to its exact K nearest neighbours from the given tree.
+// If timed, the queries are searched one at a time, so that the time of each is not affected by other threads.
+// Otherwise, they are searched in parallel, each thread taking every number_of_threads-th query, and not timed.
+static void compute_ground_truth(const VPTree &tree, const vector<vector<double>> &queries, unsigned int K, bool timed,
+                                 GroundTruth &truth)
+{
+    truth.indices.resize(queries.size());
+    truth.distances.resize(queries.size());
+    truth.times.assign(queries.size(), -1);
+    if(timed){
+        for(int q = 0; q < (int) queries.size(); q++){
+            auto start = chrono::steady_clock::now();
+            tie(truth.indices[q], truth.distances[q]) = tree.query(queries[q], K);
+            auto end = chrono::steady_clock::now();
+            truth.times[q] = chrono::duration<double>(end - start).count();
+        }
+        return;
+    }
+    int number_of_threads = max(1u, thread::hardware_concurrency());
+    vector<thread> threads;
+    for(int t = 0; t < number_of_threads; t++){
+        threads.push_back(thread([&, t](){
+            for(int q = t; q < (int) queries.size(); q += number_of_threads){
+                tie(truth.indices[q], truth.distances[q]) = tree.query(queries[q], K);
+            }
+        }));
+    }
+    for(thread &t : threads){
+        t.join();
+    }
+}
+
+GroundTruth ground_truth(const vector<vector<double>> &dataset, const vector<vector<double>> &queries, unsigned int K,
+                         const string &metric, double (*distance)(const vector<double>&, const vector<double>&),
+                         const string &directory, bool timed)
+{
+    GroundTruth truth;
+    string filename;
+    if(!metric.empty()){
+        ostringstream name;
+        name << directory << "/gt_" << hex << setfill('0') << setw(16) << checksum(dataset) << "_"
+             << setw(16) << checksum(queries) << dec << "_" << metric << "_" << K << ".bin";
+        filename = name.str();
+        // A file saved by an untimed run is only used by a timed one after its times have been measured.
+        if(load_ground_truth(filename, dataset, queries, K, truth) &&
+           (!timed || all_of(truth.times.begin(), truth.times.end(), [](double time){ return time >= 0; }))){
+            return truth;
+        }
+    }
+
+    VPTree tree(dataset, distance);
+    compute_ground_truth(tree, queries, K, timed, truth);
+
+    if(!filename.empty()){
+        error_code error;
+        filesystem::create_directories(directory, error);
+        save_ground_truth(filename, truth);
+    }
+    return truth;
+}
\ No newline at end of file
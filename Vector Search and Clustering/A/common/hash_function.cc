@@ -3,9 +3,11 @@
 #include <random>
 #include <ctime>
 #include <chrono>
+#include <stdexcept>
 // vector   is used for std::vector.
 // iterator is used for std::back_insert_iterator, std::advance().
 // random   is used for std::random_device, std::default_random_engine generator, std::normal_distribution, std::uniform_real_distribution and rand().
+// stdexcept is used for std::runtime_error.
 
 #include "hash_function.hpp"
 
@@ -29,18 +31,47 @@ HashFunction::HashFunction(int number_of_dimensions, double window)
     }
 }
 
+HashFunction::HashFunction(std::ifstream& file, int expected_dimensions)
+: number_of_dimensions(0), window(0), t(0)
+{
+    file.read((char*) &number_of_dimensions, sizeof(int));
+    file.read((char*) &window, sizeof(double));
+    file.read((char*) &t, sizeof(float));
+    if(!file || number_of_dimensions != expected_dimensions){
+        throw std::runtime_error("Index file is corrupted");
+    }
+    v.resize(number_of_dimensions);
+    file.read((char*) v.data(), number_of_dimensions * sizeof(double));
+    if(!file){
+        throw std::runtime_error("Index file is corrupted");
+    }
+}
+
 HashFunction::~HashFunction()
 {
 
 }
 
-int HashFunction::hash(const vector<double>& p)
+int HashFunction::hash(const vector<double>& p) const
 {
     if(p.size() == 0){
         return -1;
     }
 
     // Use hash function h_i(p) = floor((p * v + t) / w)
+    return floor(project(p));
+}
+
+double HashFunction::project(const vector<double>& p) const
+{
     double result = std::inner_product(p.begin(), p.end(), v.begin(), t);
-    return floor(fabs(result) / window);
+    return fabs(result) / window;
+}
+
+void HashFunction::save(std::ofstream& file) const
+{
+    file.write((char*) &number_of_dimensions, sizeof(int));
+    file.write((char*) &window, sizeof(double));
+    file.write((char*) &t, sizeof(float));
+    file.write((char*) v.data(), number_of_dimensions * sizeof(double));
 }
\ No newline at end of file
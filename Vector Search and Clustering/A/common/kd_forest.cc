@@ -0,0 +1,152 @@
+#include <vector>
+#include <tuple>
+#include <queue>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+#include <cmath>
+// queue is used for std::priority_queue.
+// cstdlib is used for rand().
+
+#include "kd_forest.hpp"
+#include "lp_metric.hpp"
+
+using namespace std;
+
+static const int VARIANCE_SAMPLE = 100; // Points of a node used to estimate the variance of each dimension.
+static const int TOP_DIMENSIONS = 5;    // Split dimension is chosen at random among this many with the highest variance.
+
+// ---------- Functions for class KDForest ---------- //
+
+KDForest::KDForest(const vector<vector<double>> &dataset, int number_of_trees, int max_leaves, int leaf_size)
+: dataset(dataset), max_leaves(max(max_leaves, 1)), leaf_size(max(leaf_size, 1))
+{
+    nodes.resize(number_of_trees);
+    indices.resize(number_of_trees);
+    for(int tree = 0; tree < number_of_trees; tree++){
+        for(int i = 0; i < (int) dataset.size(); i++){
+            indices[tree].push_back(i);
+        }
+        build(tree, 0, dataset.size());
+    }
+}
+
+int KDForest::build(int tree, int begin, int end)
+{
+    vector<int> &points = indices[tree];
+    int node = nodes[tree].size();
+    nodes[tree].push_back(Node{-1, 0, -1, -1, begin, end});
+    if(end - begin <= leaf_size){
+        return node;
+    }
+
+    // Estimate the variance of every dimension on the first points of the node
+    // and choose one of the dimensions with the highest variance at random.
+    int number_of_dimensions = dataset[points[begin]].size();
+    int sample = min(end - begin, VARIANCE_SAMPLE);
+    vector<double> mean(number_of_dimensions, 0), variance(number_of_dimensions, 0);
+    for(int i = begin; i < begin + sample; i++){
+        for(int d = 0; d < number_of_dimensions; d++){
+            mean[d] += dataset[points[i]][d];
+        }
+    }
+    for(int d = 0; d < number_of_dimensions; d++){
+        mean[d] /= sample;
+    }
+    for(int i = begin; i < begin + sample; i++){
+        for(int d = 0; d < number_of_dimensions; d++){
+            double diff = dataset[points[i]][d] - mean[d];
+            variance[d] += diff * diff;
+        }
+    }
+    vector<int> dimensions(number_of_dimensions);
+    for(int d = 0; d < number_of_dimensions; d++){
+        dimensions[d] = d;
+    }
+    int top = min(TOP_DIMENSIONS, number_of_dimensions);
+    partial_sort(dimensions.begin(), dimensions.begin() + top, dimensions.end(), [&variance](int d1, int d2){
+        return variance[d1] > variance[d2];
+    });
+    int dimension = dimensions[rand() % top];
+
+    // Split at the median of the chosen dimension.
+    int middle = begin + (end - begin) / 2;
+    nth_element(points.begin() + begin, points.begin() + middle, points.begin() + end, [&](int i, int j){
+        return dataset[i][dimension] < dataset[j][dimension];
+    });
+
+    nodes[tree][node].dimension = dimension;
+    nodes[tree][node].value = dataset[points[middle]][dimension];
+    int left = build(tree, begin, middle);
+    int right = build(tree, middle, end);
+    nodes[tree][node].left = left;
+    nodes[tree][node].right = right;
+    return node;
+}
+
+tuple<vector<int>, vector<double>> KDForest::query(const vector<double> &q, unsigned int N) const
+{
+    if(N == 0){
+        return make_tuple(vector<int>(), vector<double>());
+    }
+
+    priority_queue<tuple<double, int>> best; // Max-heap of the nearest points found (squared distance, index).
+    vector<bool> checked(dataset.size(), false); // The trees share the points, so each one is checked once.
+
+    // Min-heap of the unvisited branches of all trees (squared distance to q, tree, node), where the distance
+    // of a branch is estimated by the sum of the squared distances of q to the splits crossed to reach it.
+    typedef tuple<double, int, int> Branch;
+    priority_queue<Branch, vector<Branch>, greater<Branch>> branches;
+    for(int tree = 0; tree < (int) nodes.size(); tree++){
+        branches.push(make_tuple(0.0, tree, 0));
+    }
+
+    int leaves = 0;
+    while(!branches.empty() && leaves < max_leaves){
+        double branch_distance;
+        int tree, node;
+        tie(branch_distance, tree, node) = branches.top();
+        branches.pop();
+        if(best.size() == N && branch_distance >= get<0>(best.top())){
+            break; // The remaining branches are unlikely to contain a closer point.
+        }
+
+        // Descend to the leaf of q, keeping the other child of every node for later.
+        while(nodes[tree][node].dimension != -1){
+            const Node &n = nodes[tree][node];
+            double diff = q[n.dimension] - n.value;
+            int near = (diff <= 0) ? n.left : n.right;
+            int far = (diff <= 0) ? n.right : n.left;
+            branches.push(make_tuple(branch_distance + diff * diff, tree, far));
+            node = near;
+        }
+
+        const Node &leaf = nodes[tree][node];
+        for(int i = leaf.leaf_begin; i < leaf.leaf_end; i++){
+            int index = indices[tree][i];
+            if(checked[index]){
+                continue;
+            }
+            checked[index] = true;
+            double dist = euclidean_distance_squared(dataset[index], q);
+            if(best.size() == N){
+                if(dist >= get<0>(best.top())){
+                    continue;
+                }
+                best.pop();
+            }
+            best.push(make_tuple(dist, index));
+        }
+        leaves++;
+    }
+
+    vector<int> result_indices(best.size());
+    vector<double> result_distances(best.size());
+    for(int i = best.size() - 1; i >= 0; i--){
+        result_distances[i] = sqrt(get<0>(best.top()));
+        result_indices[i] = get<1>(best.top());
+        best.pop();
+    }
+    return make_tuple(result_indices, result_distances);
+}
\ No newline at end of file
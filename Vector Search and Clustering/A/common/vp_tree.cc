@@ -0,0 +1,145 @@
+#include <vector>
+#include <tuple>
+#include <queue>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+// queue is used for std::priority_queue.
+// cstdlib is used for rand().
+
+#include "vp_tree.hpp"
+
+using namespace std;
+
+// ---------- Functions for class VPTree ---------- //
+
+VPTree::VPTree(const vector<vector<double>> &dataset, double (*distance)(const vector<double>&, const vector<double>&), int leaf_size)
+: dataset(dataset), distance(distance), leaf_size(max(leaf_size, 1))
+{
+    for(int i = 0; i < (int) dataset.size(); i++){
+        indices.push_back(i);
+    }
+    build(0, dataset.size());
+}
+
+int VPTree::build(int begin, int end)
+{
+    int node = nodes.size();
+    nodes.push_back(Node{-1, 0, -1, -1, begin, end});
+    if(end - begin <= leaf_size){
+        return node;
+    }
+
+    // Move a random vantage point to the front and split the rest by their median distance to it.
+    swap(indices[begin], indices[begin + rand() % (end - begin)]);
+    int vantage_point = indices[begin];
+    vector<tuple<double, int>> distances;
+    for(int i = begin + 1; i < end; i++){
+        distances.push_back(make_tuple(distance(dataset[vantage_point], dataset[indices[i]]), indices[i]));
+    }
+    int middle = distances.size() / 2;
+    nth_element(distances.begin(), distances.begin() + middle, distances.end());
+    for(int i = 0; i < (int) distances.size(); i++){
+        indices[begin + 1 + i] = get<1>(distances[i]);
+    }
+
+    nodes[node].vantage_point = vantage_point;
+    nodes[node].radius = get<0>(distances[middle]);
+    int inside = (middle > 0) ? build(begin + 1, begin + 1 + middle) : -1;
+    int outside = build(begin + 1 + middle, end);
+    nodes[node].inside = inside;
+    nodes[node].outside = outside;
+    return node;
+}
+
+tuple<vector<int>, vector<double>> VPTree::search(const vector<double> &q, unsigned int N, double R,
+                                                  int max_leaves, bool skip_query) const
+{
+    double bound = (N > 0) ? numeric_limits<double>::max() : R;
+    priority_queue<tuple<double, int>> best; // Max-heap of the points found (distance, index).
+    auto consider = [&](int index, double dist){
+        if(skip_query && dist == 0 && dataset[index] == q){
+            return;
+        }
+        if(N == 0){
+            if(dist < R){
+                best.push(make_tuple(dist, index));
+            }
+            return;
+        }
+        // Points at the same distance are all kept, and at the N-th distance the smaller indices are kept.
+        if(best.size() == N){
+            if(make_tuple(dist, index) >= best.top()){
+                return;
+            }
+            best.pop();
+        }
+        best.push(make_tuple(dist, index));
+        if(best.size() == N){
+            bound = get<0>(best.top());
+        }
+    };
+
+    // Min-heap of the nodes to visit (distance lower bound, node).
+    priority_queue<tuple<double, int>, vector<tuple<double, int>>, greater<tuple<double, int>>> frontier;
+    if(!nodes.empty()){
+        frontier.push(make_tuple(0.0, 0));
+    }
+    int leaves = 0;
+    while(!frontier.empty()){
+        double lower_bound;
+        int node;
+        tie(lower_bound, node) = frontier.top();
+        frontier.pop();
+        // No point of this or any other remaining node can be closer than the bound. For N nearest neighbours,
+        // a point at the bound may still replace a tied neighbour with a larger index.
+        if(lower_bound > bound || (N == 0 && lower_bound == bound)){
+            break;
+        }
+
+        const Node &n = nodes[node];
+        if(n.vantage_point == -1){
+            for(int i = n.leaf_begin; i < n.leaf_end; i++){
+                consider(indices[i], distance(dataset[indices[i]], q));
+            }
+            leaves++;
+            if(max_leaves > 0 && leaves >= max_leaves){
+                break;
+            }
+            continue;
+        }
+
+        // By the triangle inequality, points inside the ball are at least d - radius away from q
+        // and points outside of it at least radius - d.
+        double d = distance(dataset[n.vantage_point], q);
+        consider(n.vantage_point, d);
+        if(n.inside != -1){
+            frontier.push(make_tuple(max(lower_bound, d - n.radius), n.inside));
+        }
+        if(n.outside != -1){
+            frontier.push(make_tuple(max(lower_bound, n.radius - d), n.outside));
+        }
+    }
+
+    vector<int> result_indices(best.size());
+    vector<double> result_distances(best.size());
+    for(int i = best.size() - 1; i >= 0; i--){
+        tie(result_distances[i], result_indices[i]) = best.top();
+        best.pop();
+    }
+    return make_tuple(result_indices, result_distances);
+}
+
+tuple<vector<int>, vector<double>> VPTree::query(const vector<double> &q, unsigned int N, int max_leaves) const
+{
+    if(N == 0){
+        return make_tuple(vector<int>(), vector<double>());
+    }
+    return search(q, N, 0, max_leaves, true);
+}
+
+tuple<vector<int>, vector<double>> VPTree::query_range(const vector<double> &q, double R) const
+{
+    return search(q, 0, R, 0, false);
+}
\ No newline at end of file
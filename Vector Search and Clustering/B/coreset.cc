@@ -0,0 +1,78 @@
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <numeric>
+
+#include "coreset.hpp"
+#include "lp_metric.hpp"
+#include "parallel.hpp"
+
+using namespace std;
+
+vector<int> lightweight_coreset(const vector<vector<double>> &dataset, int size, vector<double> &weights)
+{
+    int n = dataset.size();
+    weights.clear();
+    if(n == 0 || size <= 0){
+        return vector<int>();
+    }
+    int number_of_dimensions = dataset[0].size();
+    int number_of_threads = number_of_threads_for(n);
+
+    // First pass: the mean of the dataset, from the sums of a contiguous part of the dataset per thread.
+    vector<vector<double>> sums(number_of_threads, vector<double>(number_of_dimensions, 0));
+    parallel_for(n, number_of_threads, [&](int t, int begin, int end){
+        for(int i = begin; i < end; i++){
+            for(int l = 0; l < number_of_dimensions; l++){
+                sums[t][l] += dataset[i][l];
+            }
+        }
+    });
+    vector<double> mean(number_of_dimensions, 0);
+    for(int t = 0; t < number_of_threads; t++){
+        for(int l = 0; l < number_of_dimensions; l++){
+            mean[l] += sums[t][l] / n;
+        }
+    }
+
+    // Second pass: the squared distance of every point to the mean, which becomes its sampling probability.
+    vector<double> q(n);
+    vector<double> totals(number_of_threads, 0);
+    parallel_for(n, number_of_threads, [&](int t, int begin, int end){
+        for(int i = begin; i < end; i++){
+            q[i] = euclidean_distance_squared(dataset[i], mean);
+            totals[t] += q[i];
+        }
+    });
+    double total = accumulate(totals.begin(), totals.end(), 0.0);
+    for(int i = 0; i < n; i++){
+        q[i] = (total == 0) ? 1.0 / n : 0.5 / n + 0.5 * q[i] / total;
+    }
+
+    // Draw the samples as sorted uniform numbers and find them in a single scan of the cumulative probabilities.
+    random_device rd;
+    default_random_engine random_engine(rd());
+    uniform_real_distribution<double> distribution(0, 1);
+    vector<double> draws(size);
+    for(double &draw : draws){
+        draw = distribution(random_engine);
+    }
+    sort(draws.begin(), draws.end());
+    vector<int> indices;
+    double cumulative = 0;
+    int next = 0;
+    for(int i = 0; i < n && next < size; i++){
+        cumulative += q[i];
+        int count = 0;
+        // The last point also takes the draws beyond the cumulative probability due to rounding errors.
+        while(next < size && (draws[next] < cumulative || i == n - 1)){
+            count++;
+            next++;
+        }
+        if(count > 0){
+            indices.push_back(i);
+            weights.push_back(count / (size * q[i]));
+        }
+    }
+    return indices;
+}
\ No newline at end of file
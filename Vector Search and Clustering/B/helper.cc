@@ -3,8 +3,11 @@
 #include <iostream>
 #include <string>
 #include <ctime>
+#include <chrono>
+// chrono is used for the silhouette time, as clock() measures the time of all threads.
 
 #include "kmeans.hpp"
+#include "helper_kmeans.hpp"
 
 using namespace std;
 
@@ -59,13 +62,124 @@ tuple<int, int, int, int, int, int, double, int> read_config_file(const string &
 	return make_tuple(K_of_Kmeans, L, k_of_LSH, M, k_of_hypercube, probes, window, limit_queries);
 }
 
-void handle_cluster_output(KMeans &kmeans, const string &output_file, bool complete, update_method method, const tuple<int, int, int, int, int, int, double, int> &config)
+kmeans_options read_kmeans_options(const string &filename, kmeans_options options)
+{
+	ifstream config_file(filename);
+
+	// Same format as in read_config_file().
+	string line;
+	while (getline(config_file, line)) {
+		if (line[0] == '#') {
+			continue;
+		}
+		if (line.find("//") != string::npos) {
+			line = line.substr(0, line.find("//"));
+		}
+		if (line.find("mini_batch_size:") != string::npos) {
+			options.batch_size = stoi(line.substr(line.find(":") + 1));
+		}
+		else if (line.find("mini_batch_iterations:") != string::npos) {
+			options.batch_iterations = stoi(line.substr(line.find(":") + 1));
+		}
+		else if (line.find("seeding_rounds:") != string::npos) {
+			options.seeding_rounds = stoi(line.substr(line.find(":") + 1));
+		}
+		else if (line.find("seeding_oversampling:") != string::npos) {
+			options.seeding_oversampling = stod(line.substr(line.find(":") + 1));
+		}
+		else if (line.find("n_init:") != string::npos) {
+			options.restarts = stoi(line.substr(line.find(":") + 1));
+		}
+		else if (line.find("elkan_max_memory:") != string::npos) {
+			options.elkan_max_memory = stoi(line.substr(line.find(":") + 1));
+		}
+		else if (line.find("coreset_size:") != string::npos) {
+			options.coreset_size = stoi(line.substr(line.find(":") + 1));
+		}
+		else if (line.find("centroid_index_clusters:") != string::npos) {
+			options.centroid_index_clusters = stoi(line.substr(line.find(":") + 1));
+		}
+		else if (line.find("centroid_index_probes:") != string::npos) {
+			options.centroid_index_probes = stoi(line.substr(line.find(":") + 1));
+		}
+		else if (line.find("centroid_index_candidates:") != string::npos) {
+			options.centroid_index_candidates = stoi(line.substr(line.find(":") + 1));
+		}
+		else if (line.find("max_iterations:") != string::npos) {
+			options.max_iterations = stoi(line.substr(line.find(":") + 1));
+		}
+		else if (line.find("objective_tolerance:") != string::npos) {
+			options.objective_tolerance = stod(line.substr(line.find(":") + 1));
+		}
+		else if (line.find("centroid_shift_tolerance:") != string::npos) {
+			options.shift_tolerance = stod(line.substr(line.find(":") + 1));
+		}
+		else if (line.find("moved_points_tolerance:") != string::npos) {
+			options.moved_tolerance = stod(line.substr(line.find(":") + 1));
+		}
+		else if (line.find("iteration_log:") != string::npos) {
+			// The file name, without surrounding spaces.
+			string file = line.substr(line.find(":") + 1);
+			file.erase(0, file.find_first_not_of(" \t"));
+			file.erase(file.find_last_not_of(" \t\r") + 1);
+			options.iteration_log = file;
+		}
+	}
+	return options;
+}
+
+silhouette_options read_silhouette_options(const string &filename, silhouette_options options)
+{
+	ifstream config_file(filename);
+
+	// Same format as in read_config_file().
+	string line;
+	while (getline(config_file, line)) {
+		if (line[0] == '#') {
+			continue;
+		}
+		if (line.find("//") != string::npos) {
+			line = line.substr(0, line.find("//"));
+		}
+		if (line.find("silhouette_sample_size:") != string::npos) {
+			options.sample_size = stoi(line.substr(line.find(":") + 1));
+		}
+		else if (line.find("silhouette_confidence:") != string::npos) {
+			options.confidence = stod(line.substr(line.find(":") + 1));
+		}
+		else if (line.find("silhouette:") != string::npos) {
+			string method = line.substr(line.find(":") + 1);
+			if (method.find("sampled") != string::npos) {
+				options.method = SILHOUETTE_SAMPLED;
+			}
+			else if (method.find("simplified") != string::npos) {
+				options.method = SILHOUETTE_SIMPLIFIED;
+			}
+			else {
+				options.method = SILHOUETTE_EXACT;
+			}
+		}
+	}
+	return options;
+}
+
+void handle_cluster_output(KMeans &kmeans, const string &output_file, bool complete, update_method method, const tuple<int, int, int, int, int, int, double, int> &config,
+                           const silhouette_options &silhouette)
 {
 	ofstream output(output_file);
 	switch (method) {
 	case CLASSIC:
 		output << "Algorithm: Lloyds" << endl;
 		break;
+	case BATCH:
+		output << "Algorithm: Batch Lloyds" << endl;
+		break;
+	case ACCELERATED:
+		output << "Algorithm: Accelerated Lloyds" << endl;
+		break;
+	case MINI_BATCH:
+		output << "Algorithm: Mini-batch KMeans" << endl;
+		break;
 	case REVERSE_LSH:
 		output << "Algorithm: Range Search LSH" << endl;
 		break;
@@ -97,26 +211,26 @@ void handle_cluster_output(KMeans &kmeans, const string &output_file, bool compl
 	}
 	output << "clustering_time: " << time << endl;
 
-	clock_t start_silhouette = clock();
+	auto start_silhouette = chrono::steady_clock::now();
 	cout << "Computing silhouette..." << endl;
+	silhouette_result result = kmeans.silhouette(silhouette);
 	output << "Silhouette: [";
-	vector<double> si(clusters.size(), 0);
-	double stotal = 0;
-	for (int i = 0; i < (int) clusters.size(); i++) { // For each cluster.
-		for (int j = 0; j < (int) clusters[i].size(); j++) { // For each point in cluster.
-			si[i] += kmeans.silhouette(clusters[i][j]); // Add silhouette of point to cluster silhouette.
-		}
-		stotal += si[i]; // Add cluster silhouette to total silhouette.
-		si[i] /= clusters[i].size();
-	}
-	stotal /= kmeans.get_dataset_size(); // Calculate average silhouette of dataset (average of cluster silhouettes).
-	for (int i = 0; i < (int) si.size(); i++) {
-		output << si[i];
+	for (int i = 0; i < (int) result.clusters.size(); i++) {
+		output << result.clusters[i];
 		output << ", ";
 	}
-	output << stotal << "]" << endl;
-	clock_t end_silhouette = clock();
-	double silhouette_time = (double)(end_silhouette - start_silhouette) / CLOCKS_PER_SEC;
+	output << result.total << "]" << endl;
+	if (silhouette.method == SILHOUETTE_SAMPLED) {
+		// Half-widths of the confidence intervals, in the same order.
+		output << "Silhouette_confidence_" << silhouette.confidence << ": [";
+		for (int i = 0; i < (int) result.cluster_margins.size(); i++) {
+			output << result.cluster_margins[i];
+			output << ", ";
+		}
+		output << result.total_margin << "]" << endl;
+	}
+	auto end_silhouette = chrono::steady_clock::now();
+	double silhouette_time = chrono::duration<double>(end_silhouette - start_silhouette).count();
 	cout << "Silhouette time: " << silhouette_time << endl;
 
 	if (complete) {
@@ -6,6 +6,19 @@
 
 #include "kmeans.hpp"
 
-// Writes the results of the clustering to output file in the required format.
+// Writes the results of the clustering to output file in the required format,
+// with the silhouette computed with the given options.
 void handle_cluster_output(KMeans &kmeans, const std::string &output_file, bool complete, update_method method,
-                           const std::tuple<int,int,int,int,int,int,double,int> &config);
\ No newline at end of file
+                           const std::tuple<int,int,int,int,int,int,double,int> &config, const silhouette_options &silhouette);
+
+// Reads the options of the clustering methods (mini_batch_size, mini_batch_iterations, seeding_rounds,
+// seeding_oversampling, n_init, coreset_size, centroid_index_clusters, centroid_index_probes, centroid_index_candidates,
+// max_iterations, objective_tolerance, centroid_shift_tolerance, moved_points_tolerance, iteration_log)
+// from the given configuration file.
+// Options that are not in the file keep the values of the given options.
+kmeans_options read_kmeans_options(const std::string&, kmeans_options);
+
+// Reads the options of the silhouette (silhouette: exact, sampled or simplified, silhouette_sample_size,
+// silhouette_confidence) from the given configuration file.
+// Options that are not in the file keep the values of the given options.
+silhouette_options read_silhouette_options(const std::string&, silhouette_options);
\ No newline at end of file
@@ -1,21 +1,93 @@
 #include <iostream>
+#include <fstream>
 #include <vector>
 #include <set>
 #include <tuple>
 #include <unordered_map>
+#include <unordered_set>
+#include <thread>
+#include <algorithm>
+#include <numeric>
+#include <functional>
+#include <limits>
+#include <cmath>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <memory>
+#include <stdexcept>
+// chrono is used for the elapsed time of the iterations, as clock() measures the time of all threads.
 
 using namespace std;
 
 #include "kmeans.hpp"
 #include "vector_utils.hpp"
+#include "parallel.hpp"
 
 #include "lsh.hpp"
 #include "hypercube.hpp"
+#include "coreset.hpp"
+
+static const int ELKAN_MIN_CLUSTERS = 20; // Accelerated Lloyd's uses Hamerly's bounds for fewer clusters.
+static const int SEED_SAMPLE_CLUSTERS = 10; // Mini-batch KMeans seeds at least this many points per cluster.
+static const int CENTROID_INDEX_MAX_DIMENSIONS = 24; // Maximum dimensions of the hypercube of the centroids.
+static const int CORESET_MIN_CLUSTER_POINTS = 10; // A coreset has at least this many points per cluster.
+
+// Number of distances computed by counted_distance() in each thread.
+static thread_local long long counted_distances = 0;
+
+// Same as KMeans::distance, but counts the distances computed by the range queries of Reverse Search.
+static double counted_distance(const vector<double> &x, const vector<double> &y)
+{
+    counted_distances++;
+    return KMeans::distance(x, y);
+}
 
 KMeans::KMeans(const vector<std::vector<double>> &dataset) : dataset(dataset)
 {
     // Initialize with certain size to avoid reallocation.
     point_to_cluster.resize(dataset.size());
+    cluster_points.resize(dataset.size());
+    random_engine.seed(random_device()());
+}
+
+KMeans::~KMeans()
+{
+    delete lsh_index;
+    delete hypercube_index;
+    delete centroid_projection;
+}
+
+// Sets the file the LSH index of the Reverse Search is loaded from (if it exists) or saved to.
+void KMeans::set_lsh_index_file(const string &file)
+{
+    lsh_index_file = file;
+}
+
+void KMeans::set_options(const kmeans_options &new_options)
+{
+    options = new_options;
+}
+
+vector<int> KMeans::sample(int size)
+{
+    // Floyd's algorithm: for each of the last size indices j, a random index up to j is chosen, or j itself
+    // if it has already been chosen, so that no point is chosen twice, with memory proportional to size.
+    int n = dataset.size();
+    size = min(size, n);
+    unordered_set<int> chosen;
+    chosen.reserve(size);
+    vector<int> indices;
+    for(int j = n - size; j < n; j++){
+        int i = uniform_int_distribution<int>(0, j)(random_engine);
+        if(!chosen.insert(i).second){
+            i = j;
+            chosen.insert(j);
+        }
+        indices.push_back(i);
+    }
+    sort(indices.begin(), indices.end());
+    return indices;
 }
 
 double KMeans::min_dist_centroids() const
@@ -46,21 +118,47 @@ double KMeans::max_dist_centroids() const
     return max_dist;
 }
 
-void KMeans::assign_lloyds_reverse()
+void KMeans::assign_lloyds_reverse(const vector<bool> &assigned)
 {
     int old_cluster, new_cluster;
-    unordered_map<int, int>::const_iterator iter;
     for(int i = 0; i < (int) dataset.size(); i++){
-        iter = point_2_cluster.find(i);
-        if(iter != point_2_cluster.end()){
+        if(assigned[i]){
             continue;
         }
-        // Prepare for Lloyd's.
-        clusters[0].insert(i);
-        point_to_cluster[i] = 0;
         tie(old_cluster, new_cluster) = assign_lloyds(i);
-        point_2_cluster[i] = new_cluster;
-        update(old_cluster, new_cluster, i);
+        if(old_cluster != new_cluster){
+            update(old_cluster, new_cluster, i);
+        }
+    }
+}
+
+void KMeans::move_point(int index, int cluster)
+{
+    cluster_sizes[point_to_cluster[index]]--;
+    cluster_sizes[cluster]++;
+    if(!weights.empty()){
+        cluster_weights[point_to_cluster[index]] -= weights[index];
+        cluster_weights[cluster] += weights[index];
+    }
+    point_to_cluster[index] = cluster;
+}
+
+void KMeans::build_clusters()
+{
+    // Counting sort of the points by cluster: count the points of each cluster, turn the counts into offsets
+    // and place the points in increasing order, so each cluster is a sorted contiguous range.
+    int number_of_clusters = cluster_sizes.size();
+    cluster_offsets.assign(number_of_clusters + 1, 0);
+    for(int i = 0; i < (int) dataset.size(); i++){
+        cluster_offsets[point_to_cluster[i] + 1]++;
+    }
+    for(int c = 0; c < number_of_clusters; c++){
+        cluster_offsets[c + 1] += cluster_offsets[c];
+    }
+    cluster_points.resize(dataset.size());
+    vector<int> next(cluster_offsets.begin(), cluster_offsets.end() - 1);
+    for(int i = 0; i < (int) dataset.size(); i++){
+        cluster_points[next[point_to_cluster[i]]++] = i;
     }
 }
 
@@ -77,142 +175,194 @@ tuple<int,int> KMeans::assign_lloyds(int index)
             new_cluster = i;
         }
     }
-    // If the point changed cluster, update only the two affected centroids.
     if(old_cluster != new_cluster){
-        clusters[old_cluster].erase(index);
-        clusters[new_cluster].insert(index);
-        point_to_cluster[index] = new_cluster;
+        move_point(index, new_cluster);
     }
     return make_tuple(old_cluster, new_cluster);
 }
 
-void KMeans::compute_clusters_reverse_lsh()
+void KMeans::compute_clusters_reverse(const function<vector<tuple<vector<int>, vector<double>>>(const vector<double>&, const vector<double>&)> &query_range)
 {
     int inner = 0, outer = 0; // For debugging.
 
-    // Index n points into L hashtables: once for the entire algorithm.
-    LSH lsh(k_lsh, number_of_hash_tables, dataset.size() / 8, window, dataset);
-
-    // Start with radius = min(dist between centroids) / 2.
-    double radius = min_dist_centroids() / 2;
-    double max_radius = max_dist_centroids();
     bool changed_assignment = true;
-    vector<int> ball;
-    vector<double> distances;
-    int p_index;
-    unordered_map<int, int>::const_iterator iter;
+    vector<bool> assigned(dataset.size(), false); // Whether each point has been found by a range search.
+    // Whether each point lies in any ball of the current loop. It is cleared in parallel, so it holds a char per point
+    // instead of a bit, since the bits of a vector<bool> share their words among threads.
+    vector<char> found(dataset.size(), false);
+    // Distance of each point to the centroid it is assigned to, when the balls of the current loop were computed.
+    vector<double> best_distance(dataset.size());
+    vector<int> best_cluster(dataset.size());
+    vector<double> radii;
+    vector<vector<tuple<vector<int>, vector<double>>>> rings(centroids.size());
     while(changed_assignment){
         changed_assignment = false;
-        radius = min_dist_centroids() / 2;
-        max_radius = max_dist_centroids() * 4;
-        while(radius < max_radius){
+        // Start with radius = min(dist between centroids) / 2.
+        double radius = min_dist_centroids() / 2;
+        double max_radius = max_dist_centroids() * 4;
+
+        // Radii r, 2r, 4r, ... up to the maximum radius.
+        radii.clear();
+        for(; radius > 0 && radius < max_radius; radius *= 2){
+            radii.push_back(radius);
+        }
+
+        // For each centroid c, a single range/ball query centered at c for all radii, which returns the points
+        // in the ring between each radius and the previous one. The queries do not modify the index,
+        // so they run in parallel.
+        int number_of_threads = number_of_threads_for(centroids.size());
+        vector<long long> computations(number_of_threads, 0);
+        parallel_for(centroids.size(), number_of_threads, [&](int t, int begin, int end){
+            long long start = counted_distances;
+            for(int i = begin; i < end; i++){
+                rings[i] = query_range(centroids[i], radii);
+            }
+            computations[t] = counted_distances - start;
+        });
+
+        // The distances of the rings are to the centroids at the time of the queries, so the points that are already
+        // assigned are compared to the same centroids: their distance is computed once per loop, in parallel.
+        vector<int> found_points;
+        for(int i = 0; i < (int) centroids.size(); i++){
+            for(const tuple<vector<int>, vector<double>> &ring : rings[i]){
+                for(int p_index : get<0>(ring)){
+                    if(!found[p_index]){
+                        found[p_index] = true;
+                        found_points.push_back(p_index);
+                    }
+                }
+            }
+        }
+        parallel_for(found_points.size(), number_of_threads_for(found_points.size()), [&](int, int begin, int end){
+            for(int j = begin; j < end; j++){
+                int p_index = found_points[j];
+                found[p_index] = false;
+                best_cluster[p_index] = point_to_cluster[p_index];
+                best_distance[p_index] = assigned[p_index] ? distance(centroids[point_to_cluster[p_index]], dataset[p_index])
+                                                           : numeric_limits<double>::max();
+            }
+        });
+
+        computations.push_back(count_if(found_points.begin(), found_points.end(), [&assigned](int p_index){
+            return assigned[p_index];
+        }));
+
+        int moved = 0;
+        for(int r = 0; r < (int) radii.size(); r++){
+            // At each iteration, for each centroid c, the points of the ball centered at c that were not inside
+            // the previous balls. If the point lies in >= 2 balls, it is assigned to the cluster with the closest
+            // centroid, so the result does not depend on the order of the centroids.
+            vector<int> candidates;
             for(int i = 0; i < (int) centroids.size(); i++){
-                // At each iteration, for each centroid c, range/ball queries centered at c.
-                // Avoid buckets with very few items.
-                tie(ball, distances) = lsh.query_range(centroids[i], radius, distance, limit_queries);
+                const vector<int> &ball = get<0>(rings[i][r]);
+                const vector<double> &distances = get<1>(rings[i][r]);
                 for(int j = 0; j < (int) ball.size(); j++){
-                    p_index = ball[j];
-                    iter = point_2_cluster.find(p_index);
-                    if(iter == point_2_cluster.end()){
-                        point_2_cluster[p_index] = i;
-                        point_to_cluster[p_index] = i;
-                        clusters[i].insert(p_index);
-                        changed_assignment = true;
-                    }
-                    // If the point lies in >= 2 balls, assign it to the cluster with the closest centroid.
-                    else if(distances[j] < distance(centroids[iter->second], dataset[p_index])){
-                        clusters[iter->second].erase(p_index);
-                        point_2_cluster[p_index] = i;
-                        point_to_cluster[p_index] = i;
-                        clusters[i].insert(p_index);
-                        changed_assignment = true;
+                    if(distances[j] < best_distance[ball[j]]){
+                        best_distance[ball[j]] = distances[j];
+                        best_cluster[ball[j]] = i;
+                        candidates.push_back(ball[j]);
                     }
                 }
             }
+            for(int p_index : candidates){
+                if(!assigned[p_index] || best_cluster[p_index] != point_to_cluster[p_index]){
+                    assigned[p_index] = true;
+                    move_point(p_index, best_cluster[p_index]);
+                    changed_assignment = true;
+                    moved++;
+                }
+            }
             inner++;
             update();
-            radius *= 2; // Multiply radius by 2.
         }
         outer++;
+        if(end_iteration(moved, accumulate(computations.begin(), computations.end(), 0LL))){
+            break;
+        }
     }
 
     std::cout << inner << " inner and " << outer << " outer loops" << std::endl;
 
     // For every unassigned point, compare its distances to all centers
     // i.e. apply Lloyd's method for assignment.
-    assign_lloyds_reverse();
+    assign_lloyds_reverse(assigned);
 }
 
-void KMeans::compute_clusters_reverse_hypercube()
+void KMeans::build_lsh_index()
 {
-    int inner = 0, outer = 0; // For debugging.
-
-    // Index n points into the hypercube: once for the entire algorithm.
-    hypercube hypercube(dataset, k_hypercube, max_points_checked, probes, window);
-
-    // Start with radius = min(dist between centroids) / 2.
-    double radius = min_dist_centroids() / 2;
-    double max_radius = max_dist_centroids();
-    bool changed_assignment = true;
-    vector<int> ball, centroid_proj;
-    vector<double> distances;
-    int p_index;
-    unordered_map<int, int>::const_iterator iter;
-    while(changed_assignment){
-        changed_assignment = false;
-        radius = min_dist_centroids() / 2;
-        max_radius = max_dist_centroids() * 4;
-        while(radius < max_radius){
-            for(int i = 0; i < (int) centroids.size(); i++){
-                // At each iteration, for each centroid c, range/ball queries centered at c.
-                // Avoid buckets with very few items.
-                centroid_proj = hypercube.calculate_q_proj(centroids[i]);
-                tie(ball, distances) = hypercube.query_range(centroids[i], centroid_proj, radius);
-                for(int j = 0; j < (int) ball.size(); j++){
-                    p_index = ball[j];
-                    iter = point_2_cluster.find(p_index);
-                    if(iter == point_2_cluster.end()){
-                        point_2_cluster[p_index] = i;
-                        point_to_cluster[p_index] = i;
-                        clusters[i].insert(p_index);
-                        changed_assignment = true;
-                    }
-                    // If the point lies in >= 2 balls, assign it to the cluster with the closest centroid.
-                    else if(distances[j] < distance(centroids[iter->second], dataset[p_index])){
-                        clusters[iter->second].erase(p_index);
-                        point_2_cluster[p_index] = i;
-                        point_to_cluster[p_index] = i;
-                        clusters[i].insert(p_index);
-                        changed_assignment = true;
-                    }
-                }
+    // Index n points into L hashtables: once for the entire algorithm, and again only if the parameters change.
+    // If an index file is set, load the index from it, or build it and save it there for later runs.
+    tuple<int, int, double, string> parameters = make_tuple(number_of_hash_tables, k_lsh, window, lsh_index_file);
+    if(lsh_index == NULL || parameters != lsh_parameters){
+        delete lsh_index;
+        lsh_index = NULL;
+        ifstream lsh_input_file(lsh_index_file, ios::binary);
+        if(!lsh_index_file.empty() && lsh_input_file.is_open()){
+            // An index file of another dataset or format version is replaced.
+            try{
+                lsh_index = new LSH(lsh_input_file, dataset);
+            }
+            catch(const runtime_error &error){
+                cerr << error.what() << ", building it again: " << lsh_index_file << endl;
             }
-            inner++;
-            update();
-            radius *= 2; // Multiply radius by 2.
         }
-        outer++;
+        lsh_input_file.close();
+        if(lsh_index == NULL){
+            lsh_index = new LSH(k_lsh, number_of_hash_tables, dataset.size() / 8, window, dataset);
+            if(!lsh_index_file.empty()){
+                ofstream lsh_output_file(lsh_index_file, ios::binary);
+                lsh_index->save(lsh_output_file);
+            }
+        }
+        lsh_parameters = parameters;
     }
+}
 
-    std::cout << inner << " inner and " << outer << " outer loops" << std::endl;
+void KMeans::compute_clusters_reverse_lsh()
+{
+    build_lsh_index();
 
-    // For every unassigned point, compare its distances to all centers
-    // i.e. apply Lloyd's method for assignment.
-    assign_lloyds_reverse();
+    // Avoid buckets with very few items.
+    compute_clusters_reverse([this](const vector<double> &centroid, const vector<double> &radii){
+        return lsh_index->query_range(centroid, radii, counted_distance, limit_queries);
+    });
+}
+
+void KMeans::build_hypercube_index()
+{
+    // Index n points into the hypercube: once for the entire algorithm, and again only if the parameters change.
+    tuple<int, int, int, double> parameters = make_tuple(k_hypercube, max_points_checked, probes, window);
+    if(hypercube_index == NULL || parameters != hypercube_parameters){
+        delete hypercube_index;
+        hypercube_index = new hypercube(dataset, k_hypercube, max_points_checked, probes, window, counted_distance);
+        hypercube_parameters = parameters;
+    }
+}
+
+void KMeans::compute_clusters_reverse_hypercube()
+{
+    build_hypercube_index();
+
+    compute_clusters_reverse([this](const vector<double> &centroid, const vector<double> &radii){
+        return hypercube_index->query_range(centroid, hypercube_index->calculate_q_proj(centroid), radii);
+    });
 }
 
 bool KMeans::update() // MacQueen's update rule.
 {
     bool changed_centroids = false;
+    build_clusters();
     for(int i = 0; i < (int) centroids.size(); i++){ // For each cluster.
         vector<double> new_centroid(dataset[0].size(), 0);
-        for(int j : clusters[i]){ // For each point in cluster.
-            for(int l = 0; l < (int) dataset[j].size(); l++){
-                new_centroid[l] += dataset[j][l]; // Add point's coordinates.
+        for(int j = cluster_offsets[i]; j < cluster_offsets[i + 1]; j++){ // For each point in cluster.
+            const vector<double> &point = dataset[cluster_points[j]];
+            double w = weight(cluster_points[j]);
+            for(int l = 0; l < (int) point.size(); l++){
+                new_centroid[l] += w * point[l]; // Add point's coordinates.
             }
         }
         for(int l = 0; l < (int) new_centroid.size(); l++){
-            new_centroid[l] /= clusters[i].size(); // Divide by number of points.
+            new_centroid[l] /= cluster_weight(i); // Divide by number (total weight) of points.
         }
         if(new_centroid != centroids[i]){ // If centroid changed, update it.
             centroids[i] = new_centroid;
@@ -226,16 +376,20 @@ bool KMeans::update(int old_cluster, int new_cluster, int index)
 {
     bool changed_centroids = false;
 
+    // The lengths are the total weights of the clusters, which are their sizes if the points have no weights.
+    double w = weight(index);
+    vector<double> point = (w == 1) ? dataset[index] : vector_scalar_mult(dataset[index], w);
+
     // For the old cluster:
     // new_centroid = (old_centroid * old_len - new_point) / new_len.
     vector<double> old_centroid = centroids[old_cluster];
-    vector<double> new_centroid = vector_scalar_mult(old_centroid, clusters[old_cluster].size() + 1);
-    new_centroid = vector_subtraction(new_centroid, dataset[index]);
-    if(clusters[old_cluster].size() == 0){
+    vector<double> new_centroid = vector_scalar_mult(old_centroid, cluster_weight(old_cluster) + w);
+    new_centroid = vector_subtraction(new_centroid, point);
+    if(cluster_sizes[old_cluster] == 0){
         new_centroid = vector<double>(old_centroid.size(), 0);
     }
     else{
-        new_centroid = vector_scalar_mult(new_centroid, (double) 1 / clusters[old_cluster].size());
+        new_centroid = vector_scalar_mult(new_centroid, (double) 1 / cluster_weight(old_cluster));
     }
     if(new_centroid != old_centroid){
         centroids[old_cluster] = new_centroid;
@@ -245,9 +399,9 @@ bool KMeans::update(int old_cluster, int new_cluster, int index)
     // For the new cluster:
     // new_centroid = (old_centroid * old_len + new_point) / new_len.
     old_centroid = centroids[new_cluster];
-    new_centroid = vector_scalar_mult(old_centroid, clusters[new_cluster].size() - 1);
-    new_centroid = vector_addition(new_centroid, dataset[index]);
-    new_centroid = vector_scalar_mult(new_centroid, (double) 1 / clusters[new_cluster].size());
+    new_centroid = vector_scalar_mult(old_centroid, cluster_weight(new_cluster) - w);
+    new_centroid = vector_addition(new_centroid, point);
+    new_centroid = vector_scalar_mult(new_centroid, (double) 1 / cluster_weight(new_cluster));
     if(new_centroid != old_centroid){
         centroids[new_cluster] = new_centroid;
         changed_centroids = true;
@@ -261,7 +415,7 @@ void KMeans::compute_clusters_lloyds()
 
     bool first = true;
     while(true){
-        bool flag = false;
+        int moved = 0;
         if(first){ // Update centroids once before starting Lloyd's.
             first = false;
             update();
@@ -272,11 +426,12 @@ void KMeans::compute_clusters_lloyds()
             tie(old_cluster, new_cluster) = assign_lloyds(i);
             if(old_cluster != new_cluster){ // If the point changed cluster, update only the two affected centroids.
                 update(old_cluster, new_cluster, i);
-                flag = true;
+                moved++;
             }
         }
         loops++;
-        if(!flag){ // If no point changed cluster, we are done.
+        bool converged = end_iteration(moved, (long long) dataset.size() * centroids.size());
+        if(moved == 0 || converged){ // If no point changed cluster, we are done.
             break;
         }
     }
@@ -284,34 +439,782 @@ void KMeans::compute_clusters_lloyds()
     std::cout << loops << " iterations" << std::endl;
 }
 
+vector<int> KMeans::update_means(const vector<int> &assignment)
+{
+    int number_of_clusters = centroids.size();
+    int number_of_dimensions = dataset[0].size();
+    int number_of_threads = number_of_threads_for(dataset.size());
+
+    // Each thread sums the points of a contiguous part of the dataset, so that the threads share no writes.
+    vector<vector<double>> sums(number_of_threads, vector<double>(number_of_clusters * number_of_dimensions, 0));
+    vector<vector<double>> counts(number_of_threads, vector<double>(number_of_clusters, 0));
+    parallel_for(dataset.size(), number_of_threads, [&](int t, int begin, int end){
+        for(int i = begin; i < end; i++){
+            double *sum = &sums[t][assignment[i] * number_of_dimensions];
+            double w = weight(i);
+            for(int l = 0; l < number_of_dimensions; l++){
+                sum[l] += w * dataset[i][l];
+            }
+            counts[t][assignment[i]] += w;
+        }
+    });
+
+    vector<int> empty_clusters;
+    for(int c = 0; c < number_of_clusters; c++){
+        double count = 0;
+        vector<double> new_centroid(number_of_dimensions, 0);
+        for(int t = 0; t < number_of_threads; t++){
+            count += counts[t][c];
+            for(int l = 0; l < number_of_dimensions; l++){
+                new_centroid[l] += sums[t][c * number_of_dimensions + l];
+            }
+        }
+        if(count == 0){
+            empty_clusters.push_back(c);
+            continue;
+        }
+        for(int l = 0; l < number_of_dimensions; l++){
+            new_centroid[l] /= count;
+        }
+        centroids[c] = new_centroid;
+    }
+    return empty_clusters;
+}
+
+vector<int> KMeans::reseed(const vector<int> &empty_clusters, vector<int> &assignment, vector<double> &dist)
+{
+    vector<int> points;
+    for(int c : empty_clusters){
+        int farthest = max_element(dist.begin(), dist.end()) - dist.begin();
+        centroids[c] = dataset[farthest];
+        assignment[farthest] = c;
+        dist[farthest] = 0;
+        points.push_back(farthest);
+    }
+    return points;
+}
+
+void KMeans::move_points(const vector<int> &assignment)
+{
+    for(int i = 0; i < (int) dataset.size(); i++){
+        if(assignment[i] != point_to_cluster[i]){
+            move_point(i, assignment[i]);
+        }
+    }
+}
+
+double KMeans::objective() const
+{
+    int number_of_threads = number_of_threads_for(dataset.size());
+    vector<double> sums(number_of_threads, 0);
+    parallel_for(dataset.size(), number_of_threads, [&](int t, int begin, int end){
+        for(int i = begin; i < end; i++){
+            sums[t] += weight(i) * euclidean_distance_squared(dataset[i], centroids[point_to_cluster[i]]);
+        }
+    });
+    return accumulate(sums.begin(), sums.end(), 0.0);
+}
+
+double KMeans::weighted_sum(const vector<double> &values) const
+{
+    return weights.empty() ? accumulate(values.begin(), values.end(), 0.0)
+                           : inner_product(values.begin(), values.end(), weights.begin(), 0.0);
+}
+
+void KMeans::begin_iterations()
+{
+    iteration = 0;
+    last_objective = numeric_limits<double>::quiet_NaN();
+    delete centroid_projection;
+    centroid_projection = NULL;
+    last_centroids = centroids;
+    start_time = chrono::steady_clock::now();
+    if(iteration_log.is_open()){
+        iteration_log.close();
+    }
+    if(!options.iteration_log.empty()){
+        iteration_log.open(options.iteration_log);
+        iteration_log << "iteration,objective,moved,max_shift,distance_computations,seconds" << endl;
+    }
+}
+
+bool KMeans::end_iteration(int moved, long long computations, double objective)
+{
+    iteration++;
+    if(std::isnan(objective) && (options.objective_tolerance > 0 || iteration_log.is_open())){
+        objective = this->objective();
+        computations += dataset.size();
+    }
+    double max_shift = 0;
+    for(int c = 0; c < (int) centroids.size(); c++){
+        max_shift = max(max_shift, distance(last_centroids[c], centroids[c]));
+    }
+    last_centroids = centroids;
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+    if(iteration_log.is_open()){
+        iteration_log << iteration << "," << objective << "," << moved << "," << max_shift << ","
+                      << computations << "," << seconds << endl;
+    }
+
+    bool converged = (options.max_iterations > 0 && iteration >= options.max_iterations)
+                  || (options.shift_tolerance > 0 && max_shift <= options.shift_tolerance)
+                  || (options.moved_tolerance > 0 && moved >= 0 && moved <= options.moved_tolerance * dataset.size())
+                  || (options.objective_tolerance > 0 && !std::isnan(last_objective)
+                      && last_objective - objective <= options.objective_tolerance * last_objective);
+    last_objective = objective;
+    return converged;
+}
+
+// Returns the index of the centroid that is closest to x and sets min_dist to its squared distance to x
+// (the distance is euclidean, so the squared distance gives the same order).
+static int nearest_centroid(const vector<double> &x, const vector<vector<double>> &centroids, double &min_dist)
+{
+    int nearest = 0;
+    min_dist = euclidean_distance_squared(x, centroids[0]);
+    for(int c = 1; c < (int) centroids.size(); c++){
+        double dist = euclidean_distance_squared(x, centroids[c]);
+        if(dist < min_dist){
+            min_dist = dist;
+            nearest = c;
+        }
+    }
+    return nearest;
+}
+
+// Returns a hypercube of the given centroids for finding the nearest centroid of a point approximately, or NULL
+// if there are fewer than options.centroid_index_clusters centroids, or at most options.centroid_index_candidates,
+// since then every centroid may be a candidate and the index only adds its own cost. The projection is learned from the centroids,
+// so that there are about two centroids per vertex, and the vertices are probed in query-directed order.
+// Learning it is much slower than hashing the centroids, so it is learned only if projection is NULL (or has
+// a different number of dimensions) and kept in projection, and otherwise only the vertices are computed again.
+static unique_ptr<hypercube> centroid_index(const vector<vector<double>> &centroids, const kmeans_options &options,
+                                            LearnedProjection *&projection)
+{
+    int number_of_clusters = centroids.size();
+    if(options.centroid_index_clusters <= 0 || number_of_clusters < max(options.centroid_index_clusters, 4)
+       || number_of_clusters <= options.centroid_index_candidates){
+        return unique_ptr<hypercube>();
+    }
+    int k = min({(int) log2(number_of_clusters / 2), CENTROID_INDEX_MAX_DIMENSIONS, (int) centroids[0].size()});
+    unique_ptr<hypercube> index;
+    if(projection != NULL && projection->get_k() == k){
+        index.reset(new hypercube(centroids, options.centroid_index_candidates, options.centroid_index_probes,
+                                  *projection, counted_distance));
+    }
+    else{
+        index.reset(new hypercube(centroids, k, options.centroid_index_candidates, options.centroid_index_probes,
+                                  0, counted_distance, true));
+        delete projection;
+        projection = new LearnedProjection(*index->get_learned_projection());
+    }
+    index->set_directed_probing(true);
+    return index;
+}
+
+// Returns the index of the centroid that is closest to x among the candidates of the given hypercube of the centroids
+// and the given current centroid of x (if it is not -1), and sets min_dist to its squared distance to x.
+// If there are no candidates, all centroids are compared.
+static int nearest_centroid(const vector<double> &x, const vector<vector<double>> &centroids, const hypercube &index,
+                            int current, double &min_dist)
+{
+    vector<int> candidates;
+    vector<double> distances;
+    tie(candidates, distances) = index.query(x, index.calculate_q_proj(x), 1);
+    int nearest = candidates[0];
+    min_dist = (distances[0] == numeric_limits<double>::max()) ? distances[0] : distances[0] * distances[0];
+    // Staying in the current cluster is always checked exactly, so no point moves to a farther centroid.
+    if(current != -1){
+        double dist = euclidean_distance_squared(x, centroids[current]);
+        counted_distances++;
+        if(dist <= min_dist){
+            min_dist = dist;
+            nearest = current;
+        }
+    }
+    if(min_dist == numeric_limits<double>::max()){
+        counted_distances += centroids.size();
+        return nearest_centroid(x, centroids, min_dist);
+    }
+    return nearest;
+}
+
+int KMeans::assign_all(vector<int> &assignment, vector<double> &dist, long long *computations)
+{
+    unique_ptr<hypercube> index = centroid_index(centroids, options, centroid_projection);
+    int number_of_threads = number_of_threads_for(dataset.size());
+    vector<int> changed(number_of_threads, 0);
+    vector<long long> thread_computations(number_of_threads, 0);
+    parallel_for(dataset.size(), number_of_threads, [&](int t, int begin, int end){
+        long long start = counted_distances;
+        for(int i = begin; i < end; i++){
+            if(index){
+                assignment[i] = nearest_centroid(dataset[i], centroids, *index, point_to_cluster[i], dist[i]);
+            }
+            else{
+                assignment[i] = nearest_centroid(dataset[i], centroids, dist[i]);
+            }
+            changed[t] += (assignment[i] != point_to_cluster[i]);
+        }
+        thread_computations[t] = index ? counted_distances - start : (long long) (end - begin) * centroids.size();
+    });
+    if(computations != NULL){
+        *computations = accumulate(thread_computations.begin(), thread_computations.end(), 0LL);
+    }
+    return accumulate(changed.begin(), changed.end(), 0);
+}
+
+void KMeans::compute_clusters_batch()
+{
+    int loops = 0; // For debugging.
+
+    vector<int> new_cluster(dataset.size());
+    vector<double> new_dist(dataset.size()); // Squared distance of each point to its new centroid.
+    while(true){
+        long long computations;
+        int changed_points = assign_all(new_cluster, new_dist, &computations);
+
+        // Recompute every centroid once. An empty cluster gets the point that is farthest from its centroid instead.
+        vector<int> empty_clusters = update_means(new_cluster);
+        reseed(empty_clusters, new_cluster, new_dist);
+        changed_points += empty_clusters.size();
+
+        move_points(new_cluster);
+        loops++;
+        // The distances of the assignment give the objective of the previous centroids for free.
+        bool converged = end_iteration(changed_points, computations, weighted_sum(new_dist));
+        // The centroids move after the first pass even if no point changed cluster, so at least two passes are made.
+        if((changed_points == 0 && loops > 1) || converged){
+            break;
+        }
+    }
+
+    std::cout << loops << " iterations" << std::endl;
+}
+
+void KMeans::compute_clusters_mini_batch()
+{
+    int number_of_clusters = centroids.size();
+    int number_of_dimensions = dataset[0].size();
+    int batch_size = max(1, options.batch_size);
+
+    // counts[c] is the number (total weight) of sampled points that have been assigned to the c-th centroid,
+    // so each centroid moves towards a point with learning rate 1 / counts[c] (its weight / counts[c]).
+    vector<double> counts(number_of_clusters, 0);
+    vector<int> batch(batch_size), nearest(batch_size);
+    vector<double> batch_dist(batch_size);
+    int number_of_threads = number_of_threads_for(batch_size);
+    uniform_int_distribution<int> random_point(0, dataset.size() - 1);
+    // The estimates of the objective from different batches are too noisy to be compared by objective_tolerance,
+    // so it compares the objective of a fixed random sample of batch_size points instead.
+    vector<int> validation;
+    if(options.objective_tolerance > 0){
+        validation = sample(batch_size);
+    }
+    int iterations = 0;
+    while(iterations < options.batch_iterations){
+        for(int j = 0; j < batch_size; j++){
+            batch[j] = random_point(random_engine);
+        }
+        // The nearest centroids of the batch are found before any centroid moves.
+        unique_ptr<hypercube> index = centroid_index(centroids, options, centroid_projection);
+        vector<long long> computations(number_of_threads, 0);
+        parallel_for(batch_size, number_of_threads, [&](int t, int begin, int end){
+            long long start = counted_distances;
+            for(int j = begin; j < end; j++){
+                if(index){
+                    nearest[j] = nearest_centroid(dataset[batch[j]], centroids, *index, -1, batch_dist[j]);
+                }
+                else{
+                    nearest[j] = nearest_centroid(dataset[batch[j]], centroids, batch_dist[j]);
+                }
+            }
+            computations[t] = index ? counted_distances - start : (long long) (end - begin) * number_of_clusters;
+        });
+        double batch_objective = 0;
+        for(int j = 0; j < batch_size; j++){
+            int c = nearest[j];
+            double w = weight(batch[j]);
+            counts[c] += w;
+            double rate = w / counts[c];
+            batch_objective += w * batch_dist[j];
+            for(int l = 0; l < number_of_dimensions; l++){
+                centroids[c][l] += rate * (dataset[batch[j]][l] - centroids[c][l]);
+            }
+        }
+        iterations++;
+        // The objective is estimated from the distances of the batch (or of the validation sample),
+        // and the points do not change cluster until the end.
+        double estimate = batch_objective * dataset.size() / batch_size;
+        if(!validation.empty()){
+            vector<double> sums(number_of_threads, 0);
+            parallel_for(validation.size(), number_of_threads, [&](int t, int begin, int end){
+                for(int j = begin; j < end; j++){
+                    double dist;
+                    nearest_centroid(dataset[validation[j]], centroids, dist);
+                    sums[t] += weight(validation[j]) * dist;
+                }
+            });
+            estimate = accumulate(sums.begin(), sums.end(), 0.0) * dataset.size() / validation.size();
+            computations[0] += (long long) validation.size() * number_of_clusters;
+        }
+        if(end_iteration(-1, accumulate(computations.begin(), computations.end(), 0LL), estimate)){
+            break;
+        }
+    }
+
+    // Assign every point to its nearest centroid once at the end.
+    vector<int> assignment(dataset.size());
+    vector<double> dist(dataset.size());
+    assign_all(assignment, dist);
+    move_points(assignment);
+
+    std::cout << iterations << " iterations of " << batch_size << " points" << std::endl;
+}
+
+void KMeans::compute_clusters_hamerly()
+{
+    int loops = 0; // For debugging.
+    long long computations = 0;
+    long long last_total = 0; // Distance computations up to the previous iteration.
+
+    int number_of_clusters = centroids.size();
+    int number_of_points = dataset.size();
+    int number_of_threads = number_of_threads_for(number_of_points);
+
+    // upper[i] is an upper bound of the distance of the i-th point to its centroid
+    // and lower[i] a lower bound of its distance to every other centroid.
+    vector<int> assignment(number_of_points);
+    vector<double> upper(number_of_points), lower(number_of_points);
+    vector<double> half_min(number_of_clusters); // Half the distance of each centroid to its nearest other centroid.
+    vector<double> drift(number_of_clusters);
+    vector<int> changed(number_of_threads);
+    vector<long long> thread_computations(number_of_threads, 0);
+
+    // Finds the nearest centroid of the i-th point and sets the bounds to the two smallest distances.
+    auto assign = [&](int i){
+        double first = numeric_limits<double>::max(), second = numeric_limits<double>::max();
+        for(int c = 0; c < number_of_clusters; c++){
+            double dist = distance(dataset[i], centroids[c]);
+            if(dist < first){
+                second = first;
+                first = dist;
+                assignment[i] = c;
+            }
+            else if(dist < second){
+                second = dist;
+            }
+        }
+        upper[i] = first;
+        lower[i] = second;
+    };
+
+    while(true){
+        for(int c = 0; c < number_of_clusters; c++){
+            half_min[c] = numeric_limits<double>::max();
+        }
+        for(int c1 = 0; loops > 0 && c1 < number_of_clusters; c1++){
+            for(int c2 = c1 + 1; c2 < number_of_clusters; c2++){
+                double dist = distance(centroids[c1], centroids[c2]) / 2;
+                half_min[c1] = min(half_min[c1], dist);
+                half_min[c2] = min(half_min[c2], dist);
+            }
+        }
+        if(loops > 0){
+            computations += number_of_clusters * (number_of_clusters - 1) / 2;
+        }
+
+        parallel_for(number_of_points, number_of_threads, [&](int t, int begin, int end){
+            changed[t] = 0;
+            for(int i = begin; i < end; i++){
+                if(loops == 0){
+                    assign(i);
+                    thread_computations[t] += number_of_clusters;
+                }
+                else{
+                    // The centroid of the point cannot change if its distance is at most half the distance
+                    // to the nearest other centroid or at most the distance to any other centroid.
+                    double bound = max(half_min[assignment[i]], lower[i]);
+                    if(upper[i] <= bound){
+                        continue;
+                    }
+                    upper[i] = distance(dataset[i], centroids[assignment[i]]);
+                    thread_computations[t]++;
+                    if(upper[i] <= bound){
+                        continue;
+                    }
+                    assign(i);
+                    thread_computations[t] += number_of_clusters;
+                }
+                changed[t] += (assignment[i] != point_to_cluster[i]);
+            }
+        });
+        int changed_points = accumulate(changed.begin(), changed.end(), 0);
+
+        vector<vector<double>> old_centroids = centroids;
+        vector<int> empty_clusters = update_means(assignment);
+        vector<int> reseeded;
+        if(!empty_clusters.empty()){
+            // Reseeding needs the exact distances of the points to their centroids.
+            parallel_for(number_of_points, number_of_threads, [&](int, int begin, int end){
+                for(int i = begin; i < end; i++){
+                    upper[i] = distance(dataset[i], old_centroids[assignment[i]]);
+                }
+            });
+            computations += number_of_points;
+            reseeded = reseed(empty_clusters, assignment, upper);
+            changed_points += empty_clusters.size();
+        }
+
+        // Move the bounds by the distance each centroid moved.
+        int farthest = 0;
+        for(int c = 0; c < number_of_clusters; c++){
+            drift[c] = distance(old_centroids[c], centroids[c]);
+            if(drift[c] > drift[farthest]){
+                farthest = c;
+            }
+        }
+        computations += number_of_clusters;
+        double max_drift = drift[farthest], second_drift = 0;
+        for(int c = 0; c < number_of_clusters; c++){
+            if(c != farthest){
+                second_drift = max(second_drift, drift[c]);
+            }
+        }
+        parallel_for(number_of_points, number_of_threads, [&](int, int begin, int end){
+            for(int i = begin; i < end; i++){
+                upper[i] += drift[assignment[i]];
+                lower[i] -= (assignment[i] == farthest) ? second_drift : max_drift;
+            }
+        });
+        for(int i : reseeded){
+            upper[i] = 0;
+            lower[i] = 0;
+        }
+
+        move_points(assignment);
+        loops++;
+        long long total = computations + accumulate(thread_computations.begin(), thread_computations.end(), 0LL);
+        bool converged = end_iteration(changed_points, total - last_total);
+        last_total = total;
+        // The centroids move after the first pass even if no point changed cluster, so at least two passes are made.
+        if((changed_points == 0 && loops > 1) || converged){
+            break;
+        }
+    }
+
+    computations += accumulate(thread_computations.begin(), thread_computations.end(), 0LL);
+    std::cout << loops << " iterations, " << computations << " distance computations" << std::endl;
+}
+
+void KMeans::compute_clusters_elkan()
+{
+    int loops = 0; // For debugging.
+    long long computations = 0;
+    long long last_total = 0; // Distance computations up to the previous iteration.
+
+    int number_of_clusters = centroids.size();
+    int number_of_points = dataset.size();
+    int number_of_threads = number_of_threads_for(number_of_points);
+
+    // upper[i] is an upper bound of the distance of the i-th point to its centroid
+    // and lower[i * number_of_clusters + c] a lower bound of its distance to the c-th centroid.
+    vector<int> assignment(number_of_points);
+    vector<double> upper(number_of_points);
+    vector<double> lower((size_t) number_of_points * number_of_clusters);
+    vector<double> centroid_dist((size_t) number_of_clusters * number_of_clusters); // Half the distances of the centroids.
+    vector<double> half_min(number_of_clusters); // Half the distance of each centroid to its nearest other centroid.
+    vector<double> drift(number_of_clusters);
+    vector<int> changed(number_of_threads);
+    vector<long long> thread_computations(number_of_threads, 0);
+
+    while(true){
+        if(loops > 0){
+            parallel_for(number_of_clusters, number_of_threads_for(number_of_clusters), [&](int, int begin, int end){
+                for(int c1 = begin; c1 < end; c1++){
+                    half_min[c1] = numeric_limits<double>::max();
+                    for(int c2 = 0; c2 < number_of_clusters; c2++){
+                        double dist = (c1 == c2) ? 0 : distance(centroids[c1], centroids[c2]) / 2;
+                        centroid_dist[(size_t) c1 * number_of_clusters + c2] = dist;
+                        if(c1 != c2){
+                            half_min[c1] = min(half_min[c1], dist);
+                        }
+                    }
+                }
+            });
+            computations += number_of_clusters * (number_of_clusters - 1);
+        }
+
+        parallel_for(number_of_points, number_of_threads, [&](int t, int begin, int end){
+            changed[t] = 0;
+            for(int i = begin; i < end; i++){
+                double *point_lower = &lower[(size_t) i * number_of_clusters];
+                if(loops == 0){
+                    upper[i] = numeric_limits<double>::max();
+                    for(int c = 0; c < number_of_clusters; c++){
+                        point_lower[c] = distance(dataset[i], centroids[c]);
+                        if(point_lower[c] < upper[i]){
+                            upper[i] = point_lower[c];
+                            assignment[i] = c;
+                        }
+                    }
+                    thread_computations[t] += number_of_clusters;
+                }
+                else if(upper[i] > half_min[assignment[i]]){
+                    bool tight = false; // Whether upper[i] is the exact distance.
+                    for(int c = 0; c < number_of_clusters; c++){
+                        int a = assignment[i];
+                        // The c-th centroid cannot be closer if the distance to the current one is at most
+                        // the lower bound of its distance or half the distance between the two centroids.
+                        if(c == a || upper[i] <= point_lower[c] || upper[i] <= centroid_dist[(size_t) a * number_of_clusters + c]){
+                            continue;
+                        }
+                        if(!tight){
+                            upper[i] = point_lower[a] = distance(dataset[i], centroids[a]);
+                            thread_computations[t]++;
+                            tight = true;
+                            if(upper[i] <= point_lower[c] || upper[i] <= centroid_dist[(size_t) a * number_of_clusters + c]){
+                                continue;
+                            }
+                        }
+                        point_lower[c] = distance(dataset[i], centroids[c]);
+                        thread_computations[t]++;
+                        if(point_lower[c] < upper[i]){
+                            upper[i] = point_lower[c];
+                            assignment[i] = c;
+                        }
+                    }
+                }
+                changed[t] += (assignment[i] != point_to_cluster[i]);
+            }
+        });
+        int changed_points = accumulate(changed.begin(), changed.end(), 0);
+
+        vector<vector<double>> old_centroids = centroids;
+        vector<int> empty_clusters = update_means(assignment);
+        vector<int> reseeded;
+        if(!empty_clusters.empty()){
+            // Reseeding needs the exact distances of the points to their centroids.
+            parallel_for(number_of_points, number_of_threads, [&](int, int begin, int end){
+                for(int i = begin; i < end; i++){
+                    upper[i] = distance(dataset[i], old_centroids[assignment[i]]);
+                }
+            });
+            computations += number_of_points;
+            reseeded = reseed(empty_clusters, assignment, upper);
+            changed_points += empty_clusters.size();
+        }
+
+        // Move the bounds by the distance each centroid moved.
+        for(int c = 0; c < number_of_clusters; c++){
+            drift[c] = distance(old_centroids[c], centroids[c]);
+        }
+        computations += number_of_clusters;
+        parallel_for(number_of_points, number_of_threads, [&](int, int begin, int end){
+            for(int i = begin; i < end; i++){
+                double *point_lower = &lower[(size_t) i * number_of_clusters];
+                for(int c = 0; c < number_of_clusters; c++){
+                    point_lower[c] = max(point_lower[c] - drift[c], 0.0);
+                }
+                upper[i] += drift[assignment[i]];
+            }
+        });
+        for(int i : reseeded){
+            upper[i] = 0;
+            lower[(size_t) i * number_of_clusters + assignment[i]] = 0;
+        }
+
+        move_points(assignment);
+        loops++;
+        long long total = computations + accumulate(thread_computations.begin(), thread_computations.end(), 0LL);
+        bool converged = end_iteration(changed_points, total - last_total);
+        last_total = total;
+        // The centroids move after the first pass even if no point changed cluster, so at least two passes are made.
+        if((changed_points == 0 && loops > 1) || converged){
+            break;
+        }
+    }
+
+    computations += accumulate(thread_computations.begin(), thread_computations.end(), 0LL);
+    std::cout << loops << " iterations, " << computations << " distance computations" << std::endl;
+}
+
+void KMeans::compute_clusters_restarts(int k, update_method method, const tuple<int, int, int, int, int, double, int> &config)
+{
+    int restarts = options.restarts;
+
+    // The restarts share the dataset and the index of Reverse Search of this instance, which they only query.
+    if(method == REVERSE_LSH){
+        build_lsh_index();
+    }
+    else if(method == REVERSE_HYPERCUBE){
+        build_hypercube_index();
+    }
+    vector<unique_ptr<KMeans>> runs;
+    for(int r = 0; r < restarts; r++){
+        runs.push_back(unique_ptr<KMeans>(new KMeans(dataset)));
+        KMeans &run = *runs.back();
+        run.options = options;
+        run.options.restarts = 1;
+        run.weights = weights;
+        if(!options.iteration_log.empty()){
+            run.options.iteration_log = options.iteration_log + "." + to_string(r + 1);
+        }
+        run.lsh_index_file = lsh_index_file;
+        run.lsh_index = lsh_index;
+        run.lsh_parameters = lsh_parameters;
+        run.hypercube_index = hypercube_index;
+        run.hypercube_parameters = hypercube_parameters;
+    }
+
+    // Each restart has its own seeding and runs on a thread of its own, with a share of the hardware threads
+    // for its parallel loops.
+    restart_objectives.assign(restarts, 0);
+    parallel_for(restarts, number_of_threads_for(restarts), [&](int, int begin, int end){
+        for(int r = begin; r < end; r++){
+            runs[r]->compute_clusters(k, method, config);
+            restart_objectives[r] = runs[r]->objective();
+        }
+    });
+    for(unique_ptr<KMeans> &run : runs){
+        run->lsh_index = NULL;
+        run->hypercube_index = NULL;
+    }
+
+    // Keep the restart with the lowest objective.
+    int best = min_element(restart_objectives.begin(), restart_objectives.end()) - restart_objectives.begin();
+    KMeans &run = *runs[best];
+    centroids = move(run.centroids);
+    point_to_cluster = move(run.point_to_cluster);
+    cluster_sizes = move(run.cluster_sizes);
+    cluster_offsets = move(run.cluster_offsets);
+    cluster_points = move(run.cluster_points);
+
+    double mean = accumulate(restart_objectives.begin(), restart_objectives.end(), 0.0) / restarts;
+    double variance = 0;
+    for(double objective : restart_objectives){
+        variance += (objective - mean) * (objective - mean);
+    }
+    std::cout << restarts << " restarts, objective: best " << restart_objectives[best] << " (restart " << best + 1
+              << "), mean " << mean << ", worst " << *max_element(restart_objectives.begin(), restart_objectives.end())
+              << ", standard deviation " << sqrt(variance / restarts) << std::endl;
+}
+
+void KMeans::compute_clusters_coreset(int k, update_method method, const tuple<int, int, int, int, int, double, int> &config)
+{
+    auto start = chrono::steady_clock::now();
+    int size = max(options.coreset_size, CORESET_MIN_CLUSTER_POINTS * k);
+    vector<double> coreset_weights;
+    vector<vector<double>> coreset;
+    for(int i : lightweight_coreset(dataset, size, coreset_weights)){
+        coreset.push_back(dataset[i]);
+    }
+    std::cout << "Coreset of " << coreset.size() << " points in "
+              << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " seconds" << std::endl;
+
+    // The clustering (with its restarts) runs on an instance of the coreset, which builds its own indices
+    // of Reverse Search, so the LSH index file of the dataset is not used.
+    KMeans run(coreset);
+    run.options = options;
+    run.options.coreset_size = 0;
+    run.weights = move(coreset_weights);
+    run.compute_clusters(k, method, config);
+    centroids = move(run.centroids);
+    restart_objectives = move(run.restart_objectives);
+
+    // A single pass assigns every point of the dataset to its nearest centroid in parallel. The centroids of Reverse
+    // Search are not always the nearest ones of their points, so a centroid may get no point, and then it is reseeded.
+    cluster_sizes.assign(k, 0);
+    cluster_sizes[0] = dataset.size();
+    point_to_cluster.assign(dataset.size(), 0);
+    vector<int> assignment(dataset.size());
+    vector<double> dist(dataset.size());
+    assign_all(assignment, dist);
+    vector<int> sizes(k, 0), empty_clusters;
+    for(int c : assignment){
+        sizes[c]++;
+    }
+    for(int c = 0; c < k; c++){
+        if(sizes[c] == 0){
+            empty_clusters.push_back(c);
+        }
+    }
+    reseed(empty_clusters, assignment, dist);
+    move_points(assignment);
+    build_clusters();
+}
+
 void KMeans::compute_clusters(int k, update_method method, const tuple<int, int, int, int, int, double, int> &config) {
     tie(number_of_hash_tables, k_lsh, max_points_checked, k_hypercube, probes, window, limit_queries) = config;
-    // Again initialize with certain size to avoid reallocation.
-    clusters.resize(k);
-
+    if(options.coreset_size > 0 && max(options.coreset_size, CORESET_MIN_CLUSTER_POINTS * k) < (int) dataset.size()){
+        compute_clusters_coreset(k, method, config);
+        return;
+    }
+    if(options.restarts > 1){
+        compute_clusters_restarts(k, method, config);
+        return;
+    }
+    restart_objectives.clear();
     // Add all points to cluster 0.
-    for(int i = 0; i < (int) dataset.size(); i++){
-        clusters[0].insert(i);
-        point_to_cluster[i] = 0;
+    cluster_sizes.assign(k, 0);
+    cluster_sizes[0] = dataset.size();
+    point_to_cluster.assign(dataset.size(), 0);
+    if(!weights.empty()){
+        cluster_weights.assign(k, 0);
+        cluster_weights[0] = accumulate(weights.begin(), weights.end(), 0.0);
     }
 
-    // Initialize centroids using KMeans++ algorithm.
-    kmeanspp();
+    // Initialize centroids using KMeans++ algorithm, or k-means|| if seeding rounds are set.
+    // Mini-batch KMeans chooses them among a random sample of the dataset, so that it never scans the whole dataset.
+    vector<vector<double>> seed_sample;
+    vector<double> no_weights; // The sample of mini-batch KMeans has no weights.
+    if(method == MINI_BATCH){
+        for(int i : sample(max(options.batch_size, SEED_SAMPLE_CLUSTERS * k))){
+            seed_sample.push_back(dataset[i]);
+        }
+    }
+    const vector<vector<double>> &seed_points = (method == MINI_BATCH) ? seed_sample : dataset;
+    const vector<double> &seed_weights = (method == MINI_BATCH) ? no_weights : weights;
+    if(options.seeding_rounds > 0){
+        kmeans_parallel(seed_points, seed_weights);
+    }
+    else{
+        kmeanspp(seed_points, seed_weights);
+    }
 
     // Assign all points to nearest centroid, need to be initialized for all methods first.
-    for(int i = 0; i < (int) dataset.size(); i++){
+    // Batch, accelerated and mini-batch KMeans do the first assignment themselves, in parallel.
+    for(int i = 0; method != BATCH && method != ACCELERATED && method != MINI_BATCH && i < (int) dataset.size(); i++){
        assign_lloyds(i);
     }
 
+    begin_iterations();
     if(method == CLASSIC){
         compute_clusters_lloyds();
     }
+    else if(method == BATCH){
+        compute_clusters_batch();
+    }
+    else if(method == ACCELERATED){
+        // Elkan's bounds take memory proportional to n * k, but skip more distances for many clusters.
+        // Both give the same clusters, so Hamerly's bounds are used when Elkan's ones do not fit in the memory budget.
+        double elkan_memory = (double) dataset.size() * k * sizeof(double) / (1024 * 1024);
+        if(k < ELKAN_MIN_CLUSTERS || elkan_memory > options.elkan_max_memory){
+            compute_clusters_hamerly();
+        }
+        else{
+            compute_clusters_elkan();
+        }
+    }
+    else if(method == MINI_BATCH){
+        compute_clusters_mini_batch();
+    }
     else if(method == REVERSE_LSH){
         compute_clusters_reverse_lsh();
     }
     else{
         compute_clusters_reverse_hypercube();
-    } 
+    }
+    build_clusters();
 }
 
 std::vector<std::vector<double>> KMeans::get_centroids() const
@@ -323,12 +1226,8 @@ std::vector<std::vector<double>> KMeans::get_centroids() const
 std::vector<std::vector<int>> KMeans::get_clusters() const
 {
     vector<vector<int>> clusters_vector;
-    for(int i = 0; i < (int) clusters.size(); i++){
-        vector<int> cluster;
-        for(int j : clusters[i]){
-            cluster.push_back(j);
-        }
-        clusters_vector.push_back(cluster);
+    for(int i = 0; i + 1 < (int) cluster_offsets.size(); i++){
+        clusters_vector.push_back(vector<int>(cluster_points.begin() + cluster_offsets[i], cluster_points.begin() + cluster_offsets[i + 1]));
     }
     return clusters_vector;
 }
@@ -337,10 +1236,10 @@ double KMeans::silhouette(int i)
 {
     int cluster = point_to_cluster[i];
     double a = 0, b = 0;
-    for(int j : clusters[cluster]){
-        a += distance(dataset[i], dataset[j]);
+    for(int j = cluster_offsets[cluster]; j < cluster_offsets[cluster + 1]; j++){
+        a += distance(dataset[i], dataset[cluster_points[j]]);
     }
-    a /= clusters[cluster].size();
+    a /= cluster_sizes[cluster];
 
     // Find second closest cluster.
     int c1 = cluster, c2 = -1;
@@ -352,10 +1251,15 @@ double KMeans::silhouette(int i)
             }
         }
     }
-    for(int j : clusters[c2]){
-        b += distance(dataset[i], dataset[j]);
+    for(int j = cluster_offsets[c2]; j < cluster_offsets[c2 + 1]; j++){
+        b += distance(dataset[i], dataset[cluster_points[j]]);
     }
-    b /= clusters[c2].size();
+    b /= cluster_sizes[c2];
     
     return (b - a) / max(a, b);
+}
+
+silhouette_result KMeans::silhouette(const silhouette_options &options) const
+{
+    return compute_silhouette(dataset, point_to_cluster, cluster_offsets, cluster_points, centroids, options, distance);
 }
\ No newline at end of file
@@ -2,93 +2,191 @@
 #include <vector>
 #include <random>
 #include <algorithm>
+#include <numeric>
+#include <limits>
+// numeric is used for std::accumulate().
 
 #include "kmeans.hpp"
+#include "parallel.hpp"
 
 using namespace std;
 
-static vector<double> calculate_D(const vector<vector<double>> &p, const vector<vector<double>> &c);
-static vector<double> calculate_P(const vector<double> &D);
-static void normalize_vector(vector<double> &v);
-static int binary_search(const vector<double> &p, double x);
+static void update_min_distances(const vector<vector<double>> &p, const vector<vector<double>> &c, vector<double> &D,
+                                 vector<int> *nearest=NULL, int first=0);
+static int weighted_choice(const vector<double> &D, const vector<double> &weights, default_random_engine &random_engine);
+static vector<int> kmeanspp_indices(const vector<vector<double>> &p, const vector<double> &weights, int k,
+                                    default_random_engine &random_engine);
 
-void KMeans::kmeanspp() {
-	// Deep copy of the dataset using copy constructor.
-	vector<vector<double>> p(dataset);
+void KMeans::kmeanspp(const vector<vector<double>> &points, const vector<double> &weights) {
 	random_device rd;
 	default_random_engine random_engine(rd());
-	uniform_int_distribution<int> distribution(0, p.size() - 1);
-	int i = distribution(random_engine);
-	centroids.push_back(p[i]);
-	// Delete the centroid from the list of points.
-	p.erase(p.begin() + i);
-	// Calculate the distance from each point to the centroid.
-	for (int t = 1; t < (int) clusters.size(); t++) {
-		vector<double> D = calculate_D(p, centroids);
-		normalize_vector(D);
-		vector<double> P = calculate_P(D);
-		sort(P.begin(), P.end());
-		random_device rd;
-		default_random_engine random_engine(rd());
-		uniform_real_distribution<double> distribution(0, P[P.size() - 1]);
-		double x = distribution(random_engine);
-		int r = binary_search(P, x); // Find and return r such that P[r-1] < x <= P[r].
-		centroids.push_back(p[r]); // Add the centroid to the list of centroids.
-		p.erase(p.begin() + r); // Delete the centroid from the list of points.
+	centroids.clear();
+	for (int i : kmeanspp_indices(points, weights, cluster_sizes.size(), random_engine)) {
+		centroids.push_back(points[i]);
 	}
 }
 
+void KMeans::kmeans_parallel(const vector<vector<double>> &points, const vector<double> &weights) {
+	random_device rd;
+	default_random_engine random_engine(rd());
+	int k = cluster_sizes.size();
+	int n = points.size();
+	double l = options.seeding_oversampling * k; // Expected number of candidates chosen in each round.
 
-// Helper functions
+	// Start with a random candidate. D[i] is the distance of the i-th point to its nearest candidate
+	// and nearest[i] the position of that candidate in candidates. Weighted points count D[i] * weights[i] instead.
+	vector<int> candidates = {uniform_int_distribution<int>(0, n - 1)(random_engine)};
+	vector<double> D(n, numeric_limits<double>::max());
+	vector<int> nearest(n, 0);
+	update_min_distances(points, {points[candidates[0]]}, D, &nearest, 0);
 
-static vector<double> calculate_D(const vector<vector<double>> &p, const vector<vector<double>> &c) {
-	vector<double> D(p.size());
-	for (int i = 0; i < (int) p.size(); i++) {
-		double min = KMeans::distance(p[i], c[0]);
-		for (int j = 1; j < (int) c.size(); j++) {
-			double d = KMeans::distance(p[i], c[j]);
-			if (d < min) {
-				min = d;
+	int number_of_threads = number_of_threads_for(n);
+	for (int round = 0; round < options.seeding_rounds; round++) {
+		double total = weights.empty() ? accumulate(D.begin(), D.end(), 0.0) : inner_product(D.begin(), D.end(), weights.begin(), 0.0);
+		if (total == 0) {
+			break;
+		}
+		// Each point becomes a candidate independently with probability l * D[i] / total.
+		// Every thread draws from its own engine, seeded from the main one.
+		vector<unsigned int> seeds(number_of_threads);
+		for (unsigned int &seed : seeds) {
+			seed = random_engine();
+		}
+		vector<vector<int>> chosen(number_of_threads);
+		parallel_for(n, number_of_threads, [&](int t, int begin, int end) {
+			default_random_engine thread_engine(seeds[t]);
+			uniform_real_distribution<double> distribution(0, 1);
+			for (int i = begin; i < end; i++) {
+				double p = weights.empty() ? D[i] : D[i] * weights[i];
+				if (p > 0 && distribution(thread_engine) < l * p / total) {
+					chosen[t].push_back(i);
+				}
+			}
+		});
+		vector<vector<double>> new_candidates;
+		int first = candidates.size();
+		for (const vector<int> &indices : chosen) {
+			for (int i : indices) {
+				candidates.push_back(i);
+				new_candidates.push_back(points[i]);
 			}
 		}
-		D[i] = min;
+		// Only the distances to the new candidates are computed.
+		update_min_distances(points, new_candidates, D, &nearest, first);
 	}
-	return D;
-}
 
-static vector<double> calculate_P(const vector<double> &D) {
-	vector<double> P(D.size());
-	double sum = 0;
-	int r = D.size();
-	for (int i = 0; i < r; i++) {
-		sum += D[i];
-		P[i] = sum;
+	// If there are too few candidates (e.g. after very few rounds), add more with KMeans++ steps on all points.
+	while ((int) candidates.size() < k && (int) candidates.size() < n) {
+		int r = weighted_choice(D, weights, random_engine);
+		candidates.push_back(r);
+		update_min_distances(points, {points[r]}, D, &nearest, candidates.size() - 1);
+	}
+
+	// Weigh each candidate by the (weight of the) points that are closer to it than to any other candidate,
+	// which are already known from the updates of D.
+	vector<vector<double>> candidate_points;
+	for (int i : candidates) {
+		candidate_points.push_back(points[i]);
+	}
+	vector<double> candidate_weights(candidates.size(), 0);
+	for (int i = 0; i < n; i++) {
+		candidate_weights[nearest[i]] += weights.empty() ? 1 : weights[i];
+	}
+
+	// Recluster the weighted candidates into k centroids with KMeans++.
+	centroids.clear();
+	for (int j : kmeanspp_indices(candidate_points, candidate_weights, k, random_engine)) {
+		centroids.push_back(candidate_points[j]);
 	}
-	return P;
 }
 
-static void normalize_vector(vector<double> &v) {
-	double max = v[0];
-	for (int i = 1; i < (int) v.size(); i++) {
-		if (v[i] > max) {
-			max = v[i];
+
+// Helper functions
+
+// Updates D[i] to the minimum of D[i] and the distance of the i-th point to any of the given centroids, in parallel.
+// If nearest is given, nearest[i] is set to first + j whenever the j-th centroid is closer.
+static void update_min_distances(const vector<vector<double>> &p, const vector<vector<double>> &c, vector<double> &D,
+                                 vector<int> *nearest, int first) {
+	parallel_for(p.size(), number_of_threads_for(p.size()), [&](int, int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			for (int j = 0; j < (int) c.size(); j++) {
+				double d = KMeans::distance(p[i], c[j]);
+				if (d < D[i]) {
+					D[i] = d;
+					if (nearest != NULL) {
+						(*nearest)[i] = first + j;
+					}
+				}
+			}
 		}
+	});
+}
+
+// Returns an index i chosen with probability proportional to D[i] * weights[i] (weights are 1 if empty).
+// If all of them are 0, returns a random index with D[i] > 0, or a random index if there is none.
+static int weighted_choice(const vector<double> &D, const vector<double> &weights, default_random_engine &random_engine) {
+	int n = D.size();
+	int number_of_threads = number_of_threads_for(n);
+
+	// Each thread sums a contiguous part, so the part of the chosen point is found from the partial sums
+	// and only that part is scanned again.
+	vector<double> sums(number_of_threads, 0);
+	parallel_for(n, number_of_threads, [&](int t, int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			sums[t] += weights.empty() ? D[i] : D[i] * weights[i];
+		}
+	});
+	double total = accumulate(sums.begin(), sums.end(), 0.0);
+	if (total == 0) {
+		vector<int> remaining;
+		for (int i = 0; i < n; i++) {
+			if (D[i] > 0) {
+				remaining.push_back(i);
+			}
+		}
+		if (remaining.empty()) {
+			return uniform_int_distribution<int>(0, n - 1)(random_engine);
+		}
+		return remaining[uniform_int_distribution<int>(0, remaining.size() - 1)(random_engine)];
+	}
+
+	double x = uniform_real_distribution<double>(0, total)(random_engine);
+	int t = 0;
+	while (t < number_of_threads - 1 && x >= sums[t]) {
+		x -= sums[t];
+		t++;
 	}
-	for (int i = 0; i < (int) v.size(); i++) {
-		v[i] /= max;
+	int begin = (long long) n * t / number_of_threads;
+	int end = (long long) n * (t + 1) / number_of_threads;
+	int last = begin; // Last index with a positive probability, in case of rounding errors.
+	for (int i = begin; i < end; i++) {
+		double p = weights.empty() ? D[i] : D[i] * weights[i];
+		if (p > 0) {
+			last = i;
+			if (x < p) {
+				return i;
+			}
+			x -= p;
+		}
 	}
+	return last;
 }
 
-static int binary_search(const vector<double> &p, double x) {
-	int l = 0;
-	int r = p.size() - 1;
-	while (l < r) {
-		int m = (l + r) / 2;
-		if (p[m] < x) {
-			l = m + 1;
-		} else {
-			r = m;
+// Returns the indices of k of the given points chosen with KMeans++: the first one at random (with probability
+// proportional to its weight) and each next one with probability proportional to its weight times its distance
+// to the nearest chosen point. The distances are kept in an array that is only updated with the newest point,
+// so each step costs O(n) distances.
+static vector<int> kmeanspp_indices(const vector<vector<double>> &p, const vector<double> &weights, int k,
+                                    default_random_engine &random_engine) {
+	vector<double> D(p.size(), 1); // The first point is chosen only by its weight.
+	vector<int> chosen;
+	for (int t = 0; t < k && t < (int) p.size(); t++) {
+		int r = weighted_choice(D, weights, random_engine);
+		chosen.push_back(r);
+		if (t == 0) {
+			fill(D.begin(), D.end(), numeric_limits<double>::max());
 		}
+		update_min_distances(p, {p[r]}, D); // Sets D[r] to 0, so the same point is never chosen twice.
 	}
-	return l;
+	return chosen;
 }
\ No newline at end of file
@@ -20,6 +20,7 @@ int main(int argc, char *argv[]) {
 	string output_file;
 	bool complete = false;
 	string method_str = "";
+	string lsh_index_file;
 
 	for (int i = 1; i < argc; i++) {
 		if (strcmp(argv[i], "-i") == 0) {
@@ -41,8 +42,12 @@ int main(int argc, char *argv[]) {
 			method_str = argv[i + 1];
 			i++;
 		}
+		else if (strcmp(argv[i], "-lsh_index") == 0) {
+			lsh_index_file = argv[i + 1];
+			i++;
+		}
 		else if (strcmp(argv[i], "-help") == 0) {
-			cout << "Usage: ./cluster -i <input file> -c <configuration file> -o <output file> -complete <optional> -m <method: Classic OR LSH or Hypercube>" << endl;
+			cout << "Usage: ./cluster -i <input file> -c <configuration file> -o <output file> -complete <optional> -m <method: Classic OR Batch OR Accelerated OR MiniBatch OR LSH or Hypercube> -lsh_index <LSH index file, optional>" << endl;
 			return 0;
 		}
 		else {
@@ -68,6 +73,15 @@ int main(int argc, char *argv[]) {
 	if (method_str == "classic") {
 		method = CLASSIC;
 	}
+	else if (method_str == "batch") {
+		method = BATCH;
+	}
+	else if (method_str == "accelerated") {
+		method = ACCELERATED;
+	}
+	else if (method_str == "minibatch") {
+		method = MINI_BATCH;
+	}
 	else if (method_str == "lsh") {
 		method = REVERSE_LSH;
 	}
@@ -87,6 +101,8 @@ int main(int argc, char *argv[]) {
 
 	// run kmeans
 	KMeans kmeans(dataset);
+	kmeans.set_lsh_index_file(lsh_index_file);
+	kmeans.set_options(read_kmeans_options(config_file, kmeans_options()));
 
-	handle_cluster_output(kmeans, output_file, complete, method, config);
+	handle_cluster_output(kmeans, output_file, complete, method, config, read_silhouette_options(config_file, silhouette_options()));
 }
\ No newline at end of file
@@ -0,0 +1,37 @@
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <functional>
+
+#include "parallel.hpp"
+
+using namespace std;
+
+// Number of threads a thread may use for its parallel loops, or 0 for all hardware threads (e.g. the main thread).
+// The threads of a parallel loop share the threads of the thread that started it, so that nested parallel loops
+// (e.g. the clustering restarts, each with parallel loops of its own) do not start more threads than the hardware has.
+static thread_local int available_threads = 0;
+
+int number_of_threads_for(int number_of_items)
+{
+    int available = (available_threads > 0) ? available_threads : (int) thread::hardware_concurrency();
+    return max(1, min(available, number_of_items));
+}
+
+void parallel_for(int n, int number_of_threads, const function<void(int, int, int)> &function)
+{
+    int available = (available_threads > 0) ? available_threads : (int) thread::hardware_concurrency();
+    int share = max(1, available / max(number_of_threads, 1));
+    vector<thread> threads;
+    for(int t = 0; t < number_of_threads; t++){
+        int begin = (long long) n * t / number_of_threads;
+        int end = (long long) n * (t + 1) / number_of_threads;
+        threads.push_back(thread([&function, share, t, begin, end](){
+            available_threads = share;
+            function(t, begin, end);
+        }));
+    }
+    for(thread &t : threads){
+        t.join();
+    }
+}
\ No newline at end of file
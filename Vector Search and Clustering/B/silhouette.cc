@@ -0,0 +1,274 @@
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+#include "silhouette.hpp"
+#include "parallel.hpp"
+
+using namespace std;
+
+typedef double (*distance_function)(const vector<double>&, const vector<double>&);
+
+static const int TILE_SIZE = 32; // Points of each side of a tile of distances computed together.
+
+// Returns the cluster with the nearest centroid to the given point, apart from the given cluster,
+// or the given cluster if there is no other.
+static int neighbour_cluster(const vector<double> &x, int cluster, const vector<vector<double>> &centroids,
+                             distance_function distance)
+{
+    int neighbour = cluster;
+    double min_dist = 0;
+    for(int c = 0; c < (int) centroids.size(); c++){
+        if(c == cluster){
+            continue;
+        }
+        double dist = distance(x, centroids[c]);
+        if(neighbour == cluster || dist < min_dist){
+            neighbour = c;
+            min_dist = dist;
+        }
+    }
+    return neighbour;
+}
+
+// Returns (b - a) / max(a, b), or 0 if both are 0.
+static double point_silhouette(double a, double b)
+{
+    return max(a, b) == 0 ? 0 : (b - a) / max(a, b);
+}
+
+// Returns the neighbour cluster of every point, computed in parallel.
+static vector<int> neighbour_clusters(const vector<vector<double>> &dataset, const vector<int> &point_to_cluster,
+                                      const vector<vector<double>> &centroids, distance_function distance)
+{
+    vector<int> neighbour(dataset.size());
+    parallel_for(dataset.size(), number_of_threads_for(dataset.size()), [&](int, int begin, int end){
+        for(int i = begin; i < end; i++){
+            neighbour[i] = neighbour_cluster(dataset[i], point_to_cluster[i], centroids, distance);
+        }
+    });
+    return neighbour;
+}
+
+// Returns the silhouette of every point.
+static vector<double> exact_silhouettes(const vector<vector<double>> &dataset, const vector<int> &point_to_cluster,
+                                        const vector<int> &cluster_offsets, const vector<int> &cluster_points,
+                                        const vector<int> &neighbour, distance_function distance)
+{
+    int n = dataset.size();
+    int k = cluster_offsets.size() - 1;
+
+    // The distances between the points of clusters A <= B are needed if A == B (for a) or if B is the neighbour
+    // of a point of A or the opposite (for b). Each distance is computed once and added to the sums of both points.
+    vector<bool> needed(k * k, false);
+    for(int c = 0; c < k; c++){
+        needed[c * k + c] = true;
+    }
+    for(int i = 0; i < n; i++){
+        int a = point_to_cluster[i], b = neighbour[i];
+        needed[min(a, b) * k + max(a, b)] = true;
+    }
+
+    // Split the point pairs of the needed cluster pairs into tiles of TILE_SIZE x TILE_SIZE points,
+    // as (position of the first row, position of the first column) in cluster_points.
+    // For A == B, only the tiles on and above the diagonal are used.
+    struct Tile { int cluster_a, cluster_b, row, column; };
+    vector<Tile> tiles;
+    for(int A = 0; A < k; A++){
+        for(int B = A; B < k; B++){
+            if(!needed[A * k + B]){
+                continue;
+            }
+            for(int row = cluster_offsets[A]; row < cluster_offsets[A + 1]; row += TILE_SIZE){
+                int first_column = (A == B) ? row : cluster_offsets[B];
+                for(int column = first_column; column < cluster_offsets[B + 1]; column += TILE_SIZE){
+                    tiles.push_back(Tile{A, B, row, column});
+                }
+            }
+        }
+    }
+
+    // Every thread adds its distances to its own sums, which are added up at the end.
+    int number_of_threads = number_of_threads_for(tiles.size());
+    vector<vector<double>> own_sums(number_of_threads, vector<double>(n, 0));
+    vector<vector<double>> neighbour_sums(number_of_threads, vector<double>(n, 0));
+    parallel_for(tiles.size(), number_of_threads, [&](int t, int begin, int end){
+        vector<double> &own = own_sums[t];
+        vector<double> &other = neighbour_sums[t];
+        for(int tile = begin; tile < end; tile++){
+            const Tile &T = tiles[tile];
+            int row_end = min(T.row + TILE_SIZE, cluster_offsets[T.cluster_a + 1]);
+            int column_end = min(T.column + TILE_SIZE, cluster_offsets[T.cluster_b + 1]);
+            for(int r = T.row; r < row_end; r++){
+                int x = cluster_points[r];
+                bool x_needs = neighbour[x] == T.cluster_b;
+                // On a diagonal tile, each pair is visited once and the distance of a point to itself is 0.
+                for(int c = (T.cluster_a == T.cluster_b && T.row == T.column) ? r + 1 : T.column; c < column_end; c++){
+                    int y = cluster_points[c];
+                    if(T.cluster_a == T.cluster_b){
+                        double dist = distance(dataset[x], dataset[y]);
+                        own[x] += dist;
+                        own[y] += dist;
+                        continue;
+                    }
+                    bool y_needs = neighbour[y] == T.cluster_a;
+                    if(!x_needs && !y_needs){
+                        continue;
+                    }
+                    double dist = distance(dataset[x], dataset[y]);
+                    if(x_needs){
+                        other[x] += dist;
+                    }
+                    if(y_needs){
+                        other[y] += dist;
+                    }
+                }
+            }
+        }
+    });
+
+    vector<double> s(n);
+    for(int i = 0; i < n; i++){
+        double a = 0, b = 0;
+        for(int t = 0; t < number_of_threads; t++){
+            a += own_sums[t][i];
+            b += neighbour_sums[t][i];
+        }
+        int A = point_to_cluster[i], B = neighbour[i];
+        a /= cluster_offsets[A + 1] - cluster_offsets[A];
+        b = (A == B) ? 0 : b / (cluster_offsets[B + 1] - cluster_offsets[B]);
+        s[i] = (A == B) ? 0 : point_silhouette(a, b);
+    }
+    return s;
+}
+
+// Returns the average distance of x to the points of the given cluster.
+static double average_distance(const vector<double> &x, int cluster, const vector<vector<double>> &dataset,
+                               const vector<int> &cluster_offsets, const vector<int> &cluster_points,
+                               distance_function distance)
+{
+    double sum = 0;
+    for(int j = cluster_offsets[cluster]; j < cluster_offsets[cluster + 1]; j++){
+        sum += distance(x, dataset[cluster_points[j]]);
+    }
+    return sum / (cluster_offsets[cluster + 1] - cluster_offsets[cluster]);
+}
+
+// Returns the z value of the standard normal distribution for the given two-sided confidence level,
+// i.e. erf(z / sqrt(2)) = confidence, found by bisection.
+static double z_value(double confidence)
+{
+    double low = 0, high = 10;
+    for(int iteration = 0; iteration < 100; iteration++){
+        double middle = (low + high) / 2;
+        if(erf(middle / sqrt(2.0)) < confidence){
+            low = middle;
+        }
+        else{
+            high = middle;
+        }
+    }
+    return (low + high) / 2;
+}
+
+silhouette_result compute_silhouette(const vector<vector<double>> &dataset, const vector<int> &point_to_cluster,
+                                     const vector<int> &cluster_offsets, const vector<int> &cluster_points,
+                                     const vector<vector<double>> &centroids, const silhouette_options &options,
+                                     distance_function distance)
+{
+    int n = dataset.size();
+    int k = cluster_offsets.size() - 1;
+    silhouette_result result;
+    result.clusters.assign(k, 0);
+    result.cluster_margins.assign(k, 0);
+    if(n == 0){
+        return result;
+    }
+    vector<int> neighbour = neighbour_clusters(dataset, point_to_cluster, centroids, distance);
+
+    if(options.method == SILHOUETTE_SAMPLED){
+        // Sample at most sample_size points of every cluster without replacement.
+        random_device rd;
+        default_random_engine random_engine(rd());
+        vector<int> sample, sample_offsets = {0};
+        for(int c = 0; c < k; c++){
+            vector<int> points(cluster_points.begin() + cluster_offsets[c], cluster_points.begin() + cluster_offsets[c + 1]);
+            int m = min((int) points.size(), max(options.sample_size, 2));
+            for(int i = 0; i < m; i++){
+                swap(points[i], points[uniform_int_distribution<int>(i, points.size() - 1)(random_engine)]);
+                sample.push_back(points[i]);
+            }
+            sample_offsets.push_back(sample.size());
+        }
+
+        // The silhouette of every sampled point is exact.
+        vector<double> s(sample.size());
+        parallel_for(sample.size(), number_of_threads_for(sample.size()), [&](int, int begin, int end){
+            for(int j = begin; j < end; j++){
+                int i = sample[j], A = point_to_cluster[i], B = neighbour[i];
+                if(A == B){
+                    s[j] = 0;
+                    continue;
+                }
+                double a = average_distance(dataset[i], A, dataset, cluster_offsets, cluster_points, distance);
+                double b = average_distance(dataset[i], B, dataset, cluster_offsets, cluster_points, distance);
+                s[j] = point_silhouette(a, b);
+            }
+        });
+
+        // Each cluster is a stratum: its silhouette is estimated by the mean of its sample, whose variance
+        // is the sample variance over the sample size, with the finite population correction.
+        // The total is the mean of the cluster estimates weighted by the cluster sizes.
+        double z = z_value(options.confidence);
+        double total_variance = 0;
+        for(int c = 0; c < k; c++){
+            int m = sample_offsets[c + 1] - sample_offsets[c];
+            int size = cluster_offsets[c + 1] - cluster_offsets[c];
+            if(m == 0){
+                continue;
+            }
+            double mean = 0, variance = 0;
+            for(int j = sample_offsets[c]; j < sample_offsets[c + 1]; j++){
+                mean += s[j];
+            }
+            mean /= m;
+            for(int j = sample_offsets[c]; j < sample_offsets[c + 1]; j++){
+                variance += (s[j] - mean) * (s[j] - mean);
+            }
+            variance = (m > 1) ? variance / (m - 1) / m * (1 - (double) m / size) : 0;
+            result.clusters[c] = mean;
+            result.cluster_margins[c] = z * sqrt(variance);
+            double weight = (double) size / n;
+            result.total += weight * mean;
+            total_variance += weight * weight * variance;
+        }
+        result.total_margin = z * sqrt(total_variance);
+        return result;
+    }
+
+    vector<double> s;
+    if(options.method == SILHOUETTE_SIMPLIFIED){
+        s.resize(n);
+        parallel_for(n, number_of_threads_for(n), [&](int, int begin, int end){
+            for(int i = begin; i < end; i++){
+                int A = point_to_cluster[i], B = neighbour[i];
+                s[i] = (A == B) ? 0 : point_silhouette(distance(dataset[i], centroids[A]), distance(dataset[i], centroids[B]));
+            }
+        });
+    }
+    else{
+        s = exact_silhouettes(dataset, point_to_cluster, cluster_offsets, cluster_points, neighbour, distance);
+    }
+    for(int c = 0; c < k; c++){
+        for(int j = cluster_offsets[c]; j < cluster_offsets[c + 1]; j++){
+            result.clusters[c] += s[cluster_points[j]];
+        }
+        result.total += result.clusters[c];
+        if(cluster_offsets[c + 1] > cluster_offsets[c]){
+            result.clusters[c] /= cluster_offsets[c + 1] - cluster_offsets[c];
+        }
+    }
+    result.total /= n;
+    return result;
+}
\ No newline at end of file
@@ -39,15 +39,17 @@ INCLUDE := $(MY_PATH)include
 #   -Werror    Αντιμετωπίζει τα warnings σαν errors, σταματώντας το compilation
 #   -MDD       Δημιουργεί ένα .d αρχείο με τα dependencies, το οποίο μπορούμε να κάνουμε include στο Makefile
 #			   , το οποίο συμπεριλαμβάνει όλα τα header files που γίνονται include
+#   -pthread   Ενεργοποιεί την υποστήριξη για threads (std::thread)
 #
 # Το override επιτρέπει την προσθήκη επιπλέον παραμέτρων από τη γραμμή εντολών: make CFLAGS=...
 #
-override CXXFLAGS += -O3 -MMD -I$(INCLUDE) -I.
+override CXXFLAGS += -O3 -MMD -I$(INCLUDE) -I. -std=c++17 -pthread
 
 # Linker options
 #   -lm        Link με τη math library
+#   -pthread   Link με τη βιβλιοθήκη των threads
 #
-LDFLAGS += -lm
+LDFLAGS += -lm -pthread
 
 # Αν στα targets με τα οποία έχει κληθεί το make (μεταβλητή MAKECMDGOALS) υπάρχει κάποιο
 # coverage*, τότε προσθέτουμε το --coverage στα compile & link flags
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <fstream>
+#include <stdexcept>
+
+// Returns the position of the end of the given file, keeping its read position.
+inline std::streamoff end_of_file(std::ifstream& file)
+{
+    std::streampos position = file.tellg();
+    file.seekg(0, std::ios::end);
+    std::streamoff end = file.tellg();
+    file.seekg(position);
+    return end;
+}
+
+// Reads the number of elements of the given size in bytes that follow it in the given file, whose end is at the given
+// position. Throws std::runtime_error if it cannot be read, is negative or more elements than the rest of the file holds.
+inline int read_count(std::ifstream& file, std::streamoff element_size, std::streamoff end)
+{
+    int count = 0;
+    file.read((char*) &count, sizeof(int));
+    if(!file || count < 0 || (double) count * element_size > (double) (end - file.tellg())){
+        throw std::runtime_error("Index file is corrupted");
+    }
+    return count;
+}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <vector>
+
+// Returns the indices of a lightweight coreset of about the given number of points of the dataset, in increasing
+// order, and sets weights to the weight of each of them. The points are sampled with replacement, each with
+// probability q(x) = 1 / (2n) + d(x, mean)^2 / (2 * sum of d(y, mean)^2), and weighted by 1 / (size * q(x)),
+// so that the weighted objective of any centroids on the coreset estimates their objective on the whole dataset.
+// A point sampled several times is returned once with the sum of its weights.
+// It takes two parallel passes over the dataset and memory for one number per point.
+std::vector<int> lightweight_coreset(const std::vector<std::vector<double>> &dataset, int size, std::vector<double> &weights);
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+#include "lp_metric.hpp"
+
+// Default directory of the ground truth files, relative to the working directory.
+#define GROUND_TRUTH_DIRECTORY "ground_truth"
+
+// Exact nearest neighbours of a set of queries.
+struct GroundTruth
+{
+    std::vector<std::vector<int>> indices;      // Indices of the nearest neighbours of each query, sorted by distance.
+    std::vector<std::vector<double>> distances; // Distances of the nearest neighbours of each query.
+    std::vector<double> times;                  // Seconds it took to find the nearest neighbours of each query,
+                                                // or -1 if they were found in parallel and not timed.
+};
+
+// Returns the exact K nearest neighbours of every query in the given dataset based on the given distance function,
+// whose name is the given metric. They are computed with a VP-tree only the first time and saved to a file in the
+// given directory, named after the checksums of the dataset and the queries, the metric and K, from which they are
+// loaded in later runs. If the metric is empty, they are always computed. If timed, the queries are searched one at
+// a time and the time of each is kept, otherwise they are searched in parallel and not timed.
+GroundTruth ground_truth(const std::vector<std::vector<double>> &dataset, const std::vector<std::vector<double>> &queries,
+                         unsigned int K, const std::string &metric = "euclidean",
+                         double (*distance)(const std::vector<double>&, const std::vector<double>&) = euclidean_distance,
+                         const std::string &directory = GROUND_TRUTH_DIRECTORY, bool timed = false);
\ No newline at end of file
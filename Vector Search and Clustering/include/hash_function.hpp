@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <fstream>
 
 // Hash function in Euclidean space.
 class HashFunction
@@ -14,8 +15,17 @@ class HashFunction
     public:
         // Initializes a hash function with the given number of dimensions and window.
         HashFunction(int, double);
+        // Initializes a hash function from a file written by save(), which must have the given number of dimensions.
+        // Throws std::runtime_error if the file is corrupted.
+        HashFunction(std::ifstream&, int);
         ~HashFunction();
 
         // Returns the hashed value of the given vector.
-        int hash(const std::vector<double>&);
+        int hash(const std::vector<double>&) const;
+
+        // Returns the real value |p * v + t| / w, whose floor is the hashed value of the given vector p.
+        double project(const std::vector<double>&) const;
+
+        // Saves the hash function (window, shift t and vector v) to a .bin file.
+        void save(std::ofstream&) const;
 };
\ No newline at end of file
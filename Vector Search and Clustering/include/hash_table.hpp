@@ -1,11 +1,12 @@
 #pragma once
 
 #include <iostream>
+#include <fstream>
 #include <vector>
-#include <tuple>
 
 #include "list.hpp"
 #include "hash_function.hpp"
+#include "binary_file.hpp"
 
 template <typename V> class HashBucket
 {
@@ -13,9 +14,16 @@ template <typename V> class HashBucket
         const unsigned int id; // Bucket id.
         List<V> elements;
 
+        // Reads a bucket id from the given file, used to initialize the constant id when loading.
+        static unsigned int read_id(std::ifstream&);
+
     public:
         // Initializes a hash bucket with the given id.
         HashBucket(int);
+
+        // Initializes a hash bucket from a file written by save(), whose end is at the given position.
+        // Throws std::runtime_error if the file is corrupted.
+        HashBucket(std::ifstream&, std::streamoff);
         ~HashBucket();
 
         // Returns the bucket's id.
@@ -28,6 +36,18 @@ template <typename V> class HashBucket
         // Second argument shows the validity of the value returned,
         // i.e. whether the returned value is a legit instance of type V. 
         V get_data(int, bool&);
+
+        // Returns the number of values stored in the bucket.
+        int get_count() const;
+
+        // Calls the given function with each value stored in the bucket.
+        template <typename F> void for_each(F) const;
+
+        // Removes the values that satisfy the given predicate and returns the number of values removed.
+        template <typename P> int remove_if(P);
+
+        // Saves the bucket's id and values to a .bin file.
+        void save(std::ofstream&) const;
 };
 
 template <typename K, typename V> class HashTable
@@ -39,38 +59,67 @@ template <typename K, typename V> class HashTable
         const int number_of_hash_functions;        // Number of hash functions k for each hash function g_j, j = 0, ..., M.
         std::vector<HashFunction*> hash_functions; // Hash functions h_i, i = 0, ..., k.
         std::vector<int> primary_factors;          // Integers multiplied with h_i to produce the amplified index function g.
-
-        int recent_chain_index;     // Index of the most recently accessed bucket chain.
-        int recent_bucket_index;    // Index of the most recently accessed bucket inside the bucket chain.
-        int recent_element_index;   // Index of the most recently accessed element inside the bucket.
-        bool finished_chain_search; // Indicates if we have gone through all buckets in the most recently accessed bucket chain.
+        std::vector<int> pool_indices;             // Indices of h_i in a pool of hash functions shared by many tables,
+                                                   // empty if the table has its own hash functions.
 
         const static unsigned int M = ((1ULL << 32) - 5); // Large prime number for fast hashing.
 
+        // Reads an integer from the given file, used to initialize the constant members when loading.
+        static int read_int(std::ifstream&);
+
+        // Deletes the hash functions, the buckets and the bucket chains.
+        void free_table();
+
     public:
         // Initializes a hash table with the given table size, number of dimensions of data points stored,
         // number of hash functions and window.
         HashTable(int, int, int, double);
+
+        // Initializes a hash table with the given table size, whose hash functions h_i are the ones
+        // with the given indices in a pool of hash functions shared by many tables.
+        HashTable(int, const std::vector<int>&);
+
+        // Initializes a hash table from a file written by save(), whose end is at the given position,
+        // restoring its hash functions and bucket chains exactly. The hash functions must have the given number
+        // of dimensions and the table must use a shared pool of the given size, with indices smaller than it, if it is positive.
+        // Throws std::runtime_error if the file is corrupted.
+        HashTable(std::ifstream&, std::streamoff, int, int);
         ~HashTable();
 
         // Returns the size of the hash table.
         int get_table_size() const;
 
         // Returns the hashed value of the given key using the amplified index function g.
-        int primary_hash_function(K);
+        int primary_hash_function(const K&) const;
 
         // Returns the ID of the element with the given key.
-        unsigned int secondary_hash_function(K);
+        unsigned int secondary_hash_function(const K&) const;
+
+        // Returns the ID of an element, given the values of all the hash functions of the shared pool for its key.
+        // Only for tables initialized with a pool of hash functions.
+        unsigned int pooled_hash_function(const std::vector<int>&) const;
 
         // Inserts the given value with the given key inside the hash table.
-        void insert(K, V);
- 
-        // Returns a tuple containing the value and the ID of one element that lies in the same bucket chain
-        // as the element with the given key.
-        // The i-th call returns the value of the i-th element inside the same bucket chain.
-        // Second argument shows the validity of the value returned,
-        // i.e. whether the returned value is a legit instance of type V. 
-        std::tuple<V, unsigned int> get_data(K, bool&);
+        void insert(const K&, V);
+
+        // Inserts the given value inside the hash table, given the ID of its key.
+        void insert_by_id(unsigned int, V);
+
+        // Calls the given function with the value and the bucket ID of each element that lies in the bucket chain
+        // of the elements with the given ID (as returned by the secondary hash function).
+        // If the last argument is true, only the elements of the bucket with the same ID are visited.
+        // It does not change the state of the hash table, so it can be called by many threads at the same time.
+        template <typename F> void for_each_in_chain(unsigned int, F, bool same_id_only=false) const;
+
+        // Calls the given function with every value of the hash table.
+        template <typename F> void for_each(F) const;
+
+        // Removes the values for which the given predicate, called with the value and the ID of its bucket, returns true,
+        // along with any buckets and chains left empty, and returns the number of values removed.
+        template <typename P> int remove_if(P);
+
+        // Saves the hash table (hash functions or their indices in the pool, primary factors and bucket chains) to a .bin file.
+        void save(std::ofstream&) const;
 };
 
 // ---------- Functions for class HashBucket ---------- //
@@ -82,11 +131,37 @@ template <typename V> HashBucket<V>::HashBucket(int id)
     
 }
 
+// Initializes a hash bucket from a file written by save(), whose end is at the given position.
+// Throws std::runtime_error if the file is corrupted.
+template <typename V> HashBucket<V>::HashBucket(std::ifstream& file, std::streamoff end)
+: id(read_id(file))
+{
+    int count = read_count(file, sizeof(V), end);
+    std::vector<V> values(count);
+    file.read((char*) values.data(), count * sizeof(V));
+    if(!file){
+        throw std::runtime_error("Index file is corrupted");
+    }
+
+    // Values were saved from first to last, so insert them in reverse to preserve their order.
+    for(int i = count - 1; i >= 0; i--){
+        elements.insert_first(values.at(i));
+    }
+}
+
 template <typename V> HashBucket<V>::~HashBucket()
 {
 
 }
 
+// Reads a bucket id from the given file, used to initialize the constant id when loading.
+template <typename V> unsigned int HashBucket<V>::read_id(std::ifstream& file)
+{
+    unsigned int id = 0;
+    file.read((char*) &id, sizeof(unsigned int));
+    return id;
+}
+
 // Returns the bucket's id.
 template <typename V> unsigned int HashBucket<V>::get_id() const
 {
@@ -107,13 +182,41 @@ template <typename V> V HashBucket<V>::get_data(int index, bool &valid)
     return elements.get_data(index, valid);
 }
 
+// Returns the number of values stored in the bucket.
+template <typename V> int HashBucket<V>::get_count() const
+{
+    return elements.get_count();
+}
+
+// Calls the given function with each value stored in the bucket.
+template <typename V> template <typename F> void HashBucket<V>::for_each(F function) const
+{
+    elements.for_each(function);
+}
+
+// Removes the values that satisfy the given predicate and returns the number of values removed.
+template <typename V> template <typename P> int HashBucket<V>::remove_if(P predicate)
+{
+    return elements.remove_if(predicate);
+}
+
+// Saves the bucket's id and values to a .bin file.
+template <typename V> void HashBucket<V>::save(std::ofstream& file) const
+{
+    int count = elements.get_count();
+    file.write((char*) &id, sizeof(unsigned int));
+    file.write((char*) &count, sizeof(int));
+    elements.for_each([&file](V value){
+        file.write((char*) &value, sizeof(V));
+    });
+}
+
 // ---------- Functions for class HashTable ---------- //
 
 // Initializes a hash table with the given table size, number of dimensions of data points stored,
 // number of hash functions and window.
 template <typename K, typename V> HashTable<K, V>::HashTable(int table_size, int number_of_dimensions, int number_of_hash_functions, double window)
-: table_size(table_size), number_of_hash_functions(number_of_hash_functions),
-  recent_chain_index(0), recent_bucket_index(0), recent_element_index(0), finished_chain_search(true)
+: table_size(table_size), number_of_hash_functions(number_of_hash_functions)
 {
     // Initialize h_i functions, i = 1, ..., k.
     HashFunction *h;
@@ -134,7 +237,99 @@ template <typename K, typename V> HashTable<K, V>::HashTable(int table_size, int
     }
 }
 
+// Initializes a hash table with the given table size, whose hash functions h_i are the ones
+// with the given indices in a pool of hash functions shared by many tables.
+template <typename K, typename V> HashTable<K, V>::HashTable(int table_size, const std::vector<int> &pool_indices)
+: table_size(table_size), number_of_hash_functions(pool_indices.size()), pool_indices(pool_indices)
+{
+    for(int i = 0; i < number_of_hash_functions; i++){
+        primary_factors.push_back(rand());
+    }
+
+    buckets = new List<HashBucket<V>*>*[table_size];
+    for(int i = 0; i < table_size; i++){
+        buckets[i] = NULL;
+    }
+}
+
+// Initializes a hash table from a file written by save(), whose end is at the given position,
+// restoring its hash functions and bucket chains exactly. The hash functions must have the given number
+// of dimensions and the table must use a shared pool of the given size, with indices smaller than it, if it is positive.
+// Throws std::runtime_error if the file is corrupted.
+template <typename K, typename V> HashTable<K, V>::HashTable(std::ifstream& file, std::streamoff end, int number_of_dimensions,
+                                                             int pool_size)
+: table_size(read_count(file, sizeof(int), end)), number_of_hash_functions(read_count(file, sizeof(int), end))
+{
+    if(table_size == 0 || number_of_hash_functions == 0){
+        throw std::runtime_error("Index file is corrupted");
+    }
+    buckets = new List<HashBucket<V>*>*[table_size];
+    for(int i = 0; i < table_size; i++){
+        buckets[i] = NULL;
+    }
+
+    // The destructor does not run if the constructor throws, so free what has been read so far.
+    std::vector<HashBucket<V>*> chain;
+    try{
+        // The table uses a shared pool of hash functions if and only if there is one.
+        int pooled = read_int(file);
+        if(!file || pooled != (pool_size > 0)){
+            throw std::runtime_error("Index file is corrupted");
+        }
+        if(pooled){
+            pool_indices.resize(number_of_hash_functions);
+            file.read((char*) pool_indices.data(), number_of_hash_functions * sizeof(int));
+            for(int index : pool_indices){
+                if(index < 0 || index >= pool_size){
+                    throw std::runtime_error("Index file is corrupted");
+                }
+            }
+        }
+        else{
+            for(int i = 0; i < number_of_hash_functions; i++){
+                hash_functions.push_back(new HashFunction(file, number_of_dimensions));
+            }
+        }
+
+        primary_factors.resize(number_of_hash_functions);
+        file.read((char*) primary_factors.data(), number_of_hash_functions * sizeof(int));
+
+        for(int i = 0; i < table_size; i++){
+            int number_of_buckets = read_count(file, 2 * sizeof(int), end);
+            if(number_of_buckets == 0){
+                continue;
+            }
+
+            // Buckets were saved from first to last, so insert them in reverse to preserve the chain's order.
+            for(int j = 0; j < number_of_buckets; j++){
+                chain.push_back(new HashBucket<V>(file, end));
+            }
+            buckets[i] = new List<HashBucket<V>*>;
+            for(int j = number_of_buckets - 1; j >= 0; j--){
+                buckets[i]->insert_first(chain.at(j));
+            }
+            chain.clear();
+        }
+        if(!file){
+            throw std::runtime_error("Index file is corrupted");
+        }
+    }
+    catch(...){
+        for(HashBucket<V> *bucket : chain){
+            delete bucket;
+        }
+        free_table();
+        throw;
+    }
+}
+
 template <typename K, typename V> HashTable<K, V>::~HashTable()
+{
+    free_table();
+}
+
+// Deletes the hash functions, the buckets and the bucket chains.
+template <typename K, typename V> void HashTable<K, V>::free_table()
 {
     std::vector<HashFunction *>::const_iterator iter;
     for(iter = hash_functions.begin(); iter != hash_functions.end(); std::advance(iter, 1)){
@@ -156,7 +351,7 @@ template <typename K, typename V> HashTable<K, V>::~HashTable()
 }
 
 // Returns the hashed value of the given key using the amplified index function g.
-template <typename K, typename V> int HashTable<K, V>::primary_hash_function(K p)
+template <typename K, typename V> int HashTable<K, V>::primary_hash_function(const K& p) const
 {
     // Use primary hash function
     // g(p) = ( \sum_{i = 1}^{k}(r_i * h_i(p)) \mod M ) \mod table_size =
@@ -165,7 +360,7 @@ template <typename K, typename V> int HashTable<K, V>::primary_hash_function(K p
 }
 
 // Returns the ID of the element with the given key.
-template <typename K, typename V> unsigned int HashTable<K, V>::secondary_hash_function(K p)
+template <typename K, typename V> unsigned int HashTable<K, V>::secondary_hash_function(const K& p) const
 {
     // Use secondary hash function
     // h(p) = \sum_{i = 1}^{k}(r_i * h_i(p)) \mod M.
@@ -182,17 +377,45 @@ template <typename K, typename V> unsigned int HashTable<K, V>::secondary_hash_f
     return sum;
 }
 
+// Reads an integer from the given file, used to initialize the constant members when loading.
+template <typename K, typename V> int HashTable<K, V>::read_int(std::ifstream& file)
+{
+    int value = 0;
+    file.read((char*) &value, sizeof(int));
+    return value;
+}
+
 // Returns the size of the hash table.
 template <typename K, typename V> int HashTable<K, V>::get_table_size() const
 {
     return table_size;
 }
 
+// Returns the ID of an element, given the values of all the hash functions of the shared pool for its key.
+// Only for tables initialized with a pool of hash functions.
+template <typename K, typename V> unsigned int HashTable<K, V>::pooled_hash_function(const std::vector<int>& pool_values) const
+{
+    // Same as the secondary hash function, using the cached values h_i(p) of the pool.
+    int r_i, h_i;
+    unsigned int sum = 0;
+    for(int i = 0; i < number_of_hash_functions; i++){
+        r_i = primary_factors[i];
+        h_i = pool_values[pool_indices[i]];
+        sum = ((sum % M) + ((r_i * h_i) % M)) % M;
+    }
+    return sum;
+}
+
 // Inserts the given value with the given key inside the hash table.
-template <typename K, typename V> void HashTable<K, V>::insert(K key, V value)
+template <typename K, typename V> void HashTable<K, V>::insert(const K& key, V value)
 {
-    int bucket_index = primary_hash_function(key);
-    unsigned int bucket_id = secondary_hash_function(key);
+    insert_by_id(secondary_hash_function(key), value);
+}
+
+// Inserts the given value inside the hash table, given the ID of its key.
+template <typename K, typename V> void HashTable<K, V>::insert_by_id(unsigned int bucket_id, V value)
+{
+    int bucket_index = bucket_id % table_size;
     bool valid, inserted = false;
     HashBucket<V> *bucket;
     List<HashBucket<V>*> *list = buckets[bucket_index];
@@ -223,60 +446,92 @@ template <typename K, typename V> void HashTable<K, V>::insert(K key, V value)
     }
 }
 
-// Returns a tuple containing the value and the ID of one element that lies in the same bucket chain
-// as the element with the given key.
-// The i-th call returns the value of the i-th element inside the same bucket chain.
-// Second argument shows the validity of the value returned,
-// i.e. whether the returned value is a legit instance of type V.
-template <typename K, typename V> std::tuple<V, unsigned int> HashTable<K, V>::get_data(K key, bool &valid)
+// Calls the given function with the value and the bucket ID of each element that lies in the bucket chain
+// of the elements with the given ID (as returned by the secondary hash function).
+// If the last argument is true, only the elements of the bucket with the same ID are visited.
+// It does not change the state of the hash table, so it can be called by many threads at the same time.
+template <typename K, typename V> template <typename F>
+void HashTable<K, V>::for_each_in_chain(unsigned int id, F function, bool same_id_only) const
 {
-    List<HashBucket<V>*> *chain;
-    HashBucket<V> *bucket;
-    V element;
-    unsigned int bucket_id = -1;
-    bool fvalid = false; // To be used in this scope only.
-    valid = false;
-
-    if(finished_chain_search){
-        recent_chain_index = primary_hash_function(key);
-        recent_bucket_index = 0;
-        recent_element_index = 0;
-        finished_chain_search = false;
+    List<HashBucket<V>*> *chain = buckets[id % table_size];
+    if(chain == NULL){
+        return;
     }
-    chain = buckets[recent_chain_index];
+    chain->for_each([&function, id, same_id_only](HashBucket<V> *bucket){
+        unsigned int bucket_id = bucket->get_id();
+        if(same_id_only && bucket_id != id){
+            return;
+        }
+        bucket->for_each([&function, bucket_id](V element){
+            function(element, bucket_id);
+        });
+    });
+}
 
-    // Check again, in case recent_chain_index is obsolete.
-    if(chain == NULL){
-        finished_chain_search = true;
-        return std::make_tuple(V(), bucket_id);
+// Calls the given function with every value of the hash table.
+template <typename K, typename V> template <typename F> void HashTable<K, V>::for_each(F function) const
+{
+    for(int i = 0; i < table_size; i++){
+        if(buckets[i] != NULL){
+            buckets[i]->for_each([&function](HashBucket<V> *bucket){
+                bucket->for_each(function);
+            });
+        }
     }
+}
 
-    // If the chain exists, check if we have seen through all buckets.
-    bucket = chain->get_data(recent_bucket_index, fvalid);
-    if(bucket == NULL){
-        finished_chain_search = true;
-        return std::make_tuple(V(), bucket_id);
+// Removes the values for which the given predicate, called with the value and the ID of its bucket, returns true,
+// along with any buckets and chains left empty, and returns the number of values removed.
+template <typename K, typename V> template <typename P> int HashTable<K, V>::remove_if(P predicate)
+{
+    int removed = 0;
+    for(int i = 0; i < table_size; i++){
+        if(buckets[i] == NULL){
+            continue;
+        }
+        buckets[i]->remove_if([&predicate, &removed](HashBucket<V> *bucket){
+            unsigned int bucket_id = bucket->get_id();
+            removed += bucket->remove_if([&predicate, bucket_id](V value){
+                return predicate(value, bucket_id);
+            });
+            if(bucket->get_count() == 0){
+                delete bucket;
+                return true;
+            }
+            return false;
+        });
+        if(buckets[i]->get_count() == 0){
+            delete buckets[i];
+            buckets[i] = NULL;
+        }
     }
-    recent_element_index++;
-    element = bucket->get_data(recent_element_index, valid);
-    bucket_id = bucket->get_id();
-
-    // If reached the end of the bucket, look for the next bucket in the same chain.
-    if(element == V() && valid == false){
-        recent_bucket_index++;
-        bucket = chain->get_data(recent_bucket_index, fvalid);
-        if(bucket == NULL){
-            finished_chain_search = true;
-            return std::make_tuple(V(), bucket_id);
+    return removed;
+}
+
+// Saves the hash table (hash functions or their indices in the pool, primary factors and bucket chains) to a .bin file.
+template <typename K, typename V> void HashTable<K, V>::save(std::ofstream& file) const
+{
+    int pooled = !pool_indices.empty();
+    file.write((char*) &table_size, sizeof(int));
+    file.write((char*) &number_of_hash_functions, sizeof(int));
+    file.write((char*) &pooled, sizeof(int));
+    if(pooled){
+        file.write((char*) pool_indices.data(), number_of_hash_functions * sizeof(int));
+    }
+    else{
+        for(int i = 0; i < number_of_hash_functions; i++){
+            hash_functions.at(i)->save(file);
         }
-        recent_element_index = 0;
-        element = bucket->get_data(recent_element_index, valid);
-        bucket_id = bucket->get_id();
-        if(element == V() && valid == false){
-            finished_chain_search = true;
-            return std::make_tuple(element, bucket_id);
+    }
+    file.write((char*) primary_factors.data(), number_of_hash_functions * sizeof(int));
+
+    for(int i = 0; i < table_size; i++){
+        int number_of_buckets = (buckets[i] == NULL) ? 0 : buckets[i]->get_count();
+        file.write((char*) &number_of_buckets, sizeof(int));
+        if(buckets[i] != NULL){
+            buckets[i]->for_each([&file](HashBucket<V> *bucket){
+                bucket->save(file);
+            });
         }
     }
-    valid = true;
-    return std::make_tuple(element, bucket_id);
 }
\ No newline at end of file
@@ -4,54 +4,104 @@
 #include <map>
 #include <set>
 #include <unordered_map>
-#include <unordered_set>
+#include <cstdint>
+#include <tuple>
 #include "lp_metric.hpp"
 #include "hash_function.hpp"
-#include "binary_string.hpp"
+#include "learned_projection.hpp"
 
 class hypercube
 {
 private:
 	const std::vector<std::vector<double>> &p; // Dataset.
-	int k;      // Number of hash functions.
+	int k;      // Number of hash functions (at most 64, bit i of a vertex is f_i).
 	int M;      // Maximum number of candidate data points checked.
 	int probes; // Maximum number of hypercube vertices checked (probes).
+	bool directed; // Whether the vertices are probed in query-directed order instead of hamming distance order.
 
-	std::unordered_map<int, int> *f_map;
+	// Random seeds of f_i, i = 1, ..., k.
+	std::vector<uint64_t> f_seeds;
 
-	// Set of vertices that have been used in the query so far.
-	std::unordered_set<binary_string, binary_string::hash> *remaining_vertices;
+	// Indices of the points grouped by vertex: the points of a vertex are points[begin, end).
+	std::vector<int> points;
 
-	// Define hash table type that maps binary strings to vectors of indices.
-	typedef std::unordered_map<binary_string, std::vector<int>, binary_string::hash> HashTable;
-	HashTable *hash_table;
+	// With direct addressing, the points of vertex v are points[offsets[v], offsets[v + 1]). It is used only if
+	// k <= MAX_DIRECT_K and there are at most MAX_DIRECT_VERTICES_PER_POINT vertices per point, since offsets
+	// has 2^k + 1 entries however few the points are.
+	static const int MAX_DIRECT_K = 24;
+	static const int MAX_DIRECT_VERTICES_PER_POINT = 4;
+	bool direct;
+	std::vector<int> offsets;
+
+	// Otherwise, open addressing hash table of the occupied vertices with linear probing.
+	// Slot i holds a vertex and the position of its points; empty slots have begin == end.
+	std::vector<uint64_t> slot_vertices;
+	std::vector<int> slot_begins, slot_ends;
+
+	// Returns the first slot to probe for the given vertex.
+	size_t slot(uint64_t vertex) const;
+
+	// Sets begin and end so that the points of the given vertex are points[begin, end).
+	void find_vertex(uint64_t vertex, int &begin, int &end) const;
 
 	// Hash functions h_i, i = 1, ..., k.
 	std::vector<HashFunction*> hash_functions;
 
-	// Define f_i(x) = 0 or 1.
-	int f(int x, int i);
+	// Learned projection used instead of h_i and f_i, NULL if the projection is random.
+	LearnedProjection *learned_projection;
+
+	// Define f_i(x) = 0 or 1, chosen uniformly at random for every x but always the same for the same x.
+	int f(int x, int i) const;
+
+	// Advances positions, the bits flipped to get a vertex from the query's vertex, to the next vertex
+	// in increasing hamming distance. Returns false if every vertex has been visited.
+	bool next_vertex(std::vector<int> &positions) const;
 
-	// Returns the vertices that are at hamming distance from q_proj.
-	std::vector<std::vector<int>> pack(const std::vector<int> &q_proj, int hamming_distance);
+	// Returns the vertices probed for q, whose projection is q_proj, in the order they are checked.
+	std::vector<uint64_t> probe_sequence(const std::vector<double> &q, uint64_t q_proj) const;
+
+	// Groups the indices of the points by their vertex.
+	void group_points();
 
 public:
 	// Initializes an instance with the given dataset, number of dimensions k, maximum number of candidate data points checked,
 	// maximum number of hypercube vertices checked (probes), window and uses the given distance function.
+	// If learned is true, the points are projected with PCA and ITQ trained on the dataset instead of random h_i and f_i
+	// (the window is then unused).
 	hypercube(const std::vector<std::vector<double>> &p, int k, int M, int probes, double window,
+			  double (*distance)(const std::vector<double> &, const std::vector<double> &) = euclidean_distance,
+			  bool learned = false);
+	// Initializes an instance like the above with a learned projection, but with a copy of the given projection
+	// instead of training one on the dataset, so that only the vertices of the points are computed.
+	hypercube(const std::vector<std::vector<double>> &p, int M, int probes, const LearnedProjection &projection,
 			  double (*distance)(const std::vector<double> &, const std::vector<double> &) = euclidean_distance);
 	~hypercube();
 
 	// Returns the indices of the N nearest neighbours of q and their distances to q.
-	std::tuple<std::vector<int>, std::vector<double>> query(const std::vector<double> &q, const std::vector<int> &q_proj, int N);
+	// Queries do not modify the hypercube, so they can run concurrently.
+	std::tuple<std::vector<int>, std::vector<double>> query(const std::vector<double> &q, uint64_t q_proj, int N) const;
 	
 	// Returns the indices of the neighbours of q that lie within radius R and their distances to q.
-	std::tuple<std::vector<int>, std::vector<double>> query_range(const std::vector<double> &q, const std::vector<int> &q_proj, double R);
+	std::tuple<std::vector<int>, std::vector<double>> query_range(const std::vector<double> &q, uint64_t q_proj, double R) const;
+
+	// Returns, for each of the given radii (sorted in increasing order), the indices of the neighbours of q that lie
+	// within this radius but not within any of the previous radii and their distances to q.
+	// The candidates are checked and their distances computed only once for all radii.
+	std::vector<std::tuple<std::vector<int>, std::vector<double>>> query_range(const std::vector<double> &q, uint64_t q_proj,
+	                                                                           const std::vector<double> &radii) const;
 	
-	// Returns the projection of q.
-	std::vector<int> calculate_q_proj(const std::vector<double> &q);
+	// Sets whether the vertices are probed in query-directed order, i.e. by flipping first the bits whose h_i(q)
+	// lies closest to a window boundary after which f_i changes, instead of plain hamming distance order.
+	void set_directed_probing(bool directed) { this->directed = directed; }
+
+	// Returns the projection of q, i.e. the vertex with bit i equal to f_i(h_i(q)).
+	uint64_t calculate_q_proj(const std::vector<double> &q) const;
+
+	// Returns the dataset.
+	const std::vector<std::vector<double>> &get_dataset() const { return p; }
 
-	std::vector<std::vector<double>> get_dataset() { return p; }
+	// Returns the learned projection, or NULL if the projection is random.
+	const LearnedProjection *get_learned_projection() const { return learned_projection; }
 	
 	// Distance function.
 	double (*distance)(const std::vector<double> &, const std::vector<double> &);
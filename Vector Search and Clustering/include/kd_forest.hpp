@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+#include <tuple>
+
+// Forest of randomized KD-trees for approximate nearest neighbour search in euclidean space,
+// suited to low-dimensional data (e.g. tens of dimensions).
+// Each tree splits its nodes at the median of a dimension chosen at random among the ones with the highest
+// variance, so the trees partition the space differently. A query descends all trees with a single priority queue
+// of the unvisited branches, ordered by their distance to the query, and stops after a budget of leaves.
+class KDForest
+{
+    private:
+        struct Node
+        {
+            int dimension;       // Split dimension, or -1 for a leaf.
+            double value;        // Split value: left child has the points with coordinate <= value.
+            int left;            // Left child.
+            int right;           // Right child.
+            int leaf_begin;      // The points of a leaf are indices[tree][leaf_begin, leaf_end).
+            int leaf_end;
+        };
+
+        const std::vector<std::vector<double>> &dataset;
+        const int max_leaves;      // Maximum number of leaves visited by a query over all trees.
+        const int leaf_size;       // Maximum number of points of a leaf.
+
+        std::vector<std::vector<Node>> nodes;    // nodes[tree][0] is the root of the tree.
+        std::vector<std::vector<int>> indices;   // Indices of the points of each tree, grouped by leaf.
+
+        // Builds the subtree of the points indices[tree][begin, end) and returns its node.
+        int build(int tree, int begin, int end);
+
+    public:
+        // Initializes a forest of the given number of trees for the given dataset.
+        // Queries visit at most max_leaves leaves in total, so larger values give more accurate results.
+        KDForest(const std::vector<std::vector<double>>&, int number_of_trees=4, int max_leaves=64, int leaf_size=16);
+
+        // Returns the indices of the approximate N nearest neighbours of q and their euclidean distances to q,
+        // sorted by distance.
+        std::tuple<std::vector<int>, std::vector<double>> query(const std::vector<double> &q, unsigned int N) const;
+};
\ No newline at end of file
@@ -1,26 +1,82 @@
 #pragma once
 
 #include <vector>
+#include <string>
 #include <tuple>
-#include <unordered_set>
-#include <unordered_map>
+#include <functional>
+#include <fstream>
+#include <chrono>
+#include <limits>
+#include <random>
 
 #include "lp_metric.hpp"
+#include "silhouette.hpp"
 
-typedef enum {CLASSIC, REVERSE_LSH, REVERSE_HYPERCUBE} update_method;
+class LSH;
+class hypercube;
+class LearnedProjection;
+
+typedef enum {CLASSIC, BATCH, ACCELERATED, MINI_BATCH, REVERSE_LSH, REVERSE_HYPERCUBE} update_method;
+
+// Options of the clustering methods that are not part of the configuration of compute_clusters().
+struct kmeans_options
+{
+    int batch_size = 1024;       // Points sampled in each iteration of mini-batch KMeans.
+    int batch_iterations = 100;  // Iterations of mini-batch KMeans.
+    int seeding_rounds = 0;           // Rounds of k-means|| seeding, or 0 for KMeans++ seeding.
+    double seeding_oversampling = 2;  // Candidates chosen in each round of k-means|| seeding, per cluster.
+    int restarts = 1;                 // Independent runs with their own seeding, of which the lowest objective is kept.
+
+    // Accelerated KMeans uses Hamerly's bounds instead of Elkan's ones when the lower bounds of Elkan's bounds
+    // (one per point and centroid, i.e. 8 * n * k bytes) would take more than this many megabytes.
+    int elkan_max_memory = 256;
+
+    // If positive and smaller than the dataset, the clustering runs on a weighted coreset of about this many points
+    // (see lightweight_coreset()) and every point of the dataset is then assigned to its nearest centroid once.
+    int coreset_size = 0;
+
+    // For at least this many clusters (0 for never), batch and mini-batch KMeans find the nearest centroid of a point
+    // among the candidates of a hypercube of the centroids, instead of all centroids. Its projection is learned once
+    // per clustering and only the vertices of the centroids are computed again in every iteration. It is never used
+    // for at most centroid_index_candidates clusters, where it would compare every centroid anyway.
+    int centroid_index_clusters = 0;
+    int centroid_index_probes = 16;      // Vertices of the hypercube of the centroids probed for each point.
+    int centroid_index_candidates = 64;  // Maximum number of centroids compared to each point.
+
+    // The clustering stops as soon as any of the following holds (besides when no point changes cluster).
+    // Zero disables each of them.
+    int max_iterations = 0;          // Maximum number of iterations (loops of Reverse Search).
+    double objective_tolerance = 0;  // The objective decreased by at most this fraction of its previous value
+                                     // (for mini-batch KMeans, the objective of a fixed sample of batch_size points).
+    double shift_tolerance = 0;      // No centroid moved more than this distance.
+    double moved_tolerance = 0;      // At most this fraction of the points changed cluster.
+
+    // CSV file where the objective, the points that changed cluster, the largest centroid shift, the distance
+    // computations and the elapsed time of every iteration are written, or empty for no log.
+    std::string iteration_log;
+};
 
 class KMeans
 {
     private:
-        // Initializes centroids with random points from dataset using KMeans++ algorithm.
-        void kmeanspp();
+        // Initializes centroids with random points among the given ones (e.g. the dataset) using KMeans++ algorithm,
+        // where each point is chosen with probability proportional to its weight, if weights are given.
+        void kmeanspp(const std::vector<std::vector<double>>&, const std::vector<double> &weights);
+
+        // Initializes centroids among the given (weighted) points using k-means||: in each of a few rounds, every point
+        // becomes a candidate with probability proportional to its distance to the nearest candidate, and the candidates,
+        // weighted by the weight of the points nearest to them, are then reduced to k centroids with KMeans++.
+        void kmeans_parallel(const std::vector<std::vector<double>>&, const std::vector<double> &weights);
+
+        // Returns the indices of the given number of distinct random points of the dataset, in increasing order.
+        std::vector<int> sample(int);
 
         double min_dist_centroids() const;
         double max_dist_centroids() const;
 
         // Uses the Classic KMeans algoritm (Lloyd's algorithm) to assign
         // any unassigned points in Reverse Search clustering algorithms.
-        void assign_lloyds_reverse();
+        void assign_lloyds_reverse(const std::vector<bool> &assigned);
 
         // Assigns the given point to the cluster with the nearest centroid
         // and returns both old and new cluster of the point (they may be the same).
@@ -33,30 +89,139 @@ class KMeans
         // Cluster computation using the Classic KMeans algoritm (Lloyd's algorithm),
         // Reverse Search using LSH and Reverse Search using Hypercube respectively.
         void compute_clusters_lloyds();
+        // Batch Lloyd's algorithm: all points are assigned in parallel and the centroids are updated once per iteration.
+        void compute_clusters_batch();
+        // Batch Lloyd's algorithm accelerated with the triangle inequality, using Hamerly's bounds (one lower bound
+        // per point) or Elkan's bounds (one lower bound per point and centroid). Both give the same clusters as batch
+        // Lloyd's algorithm, but skip the distances that cannot change the nearest centroid of a point.
+        void compute_clusters_hamerly();
+        void compute_clusters_elkan();
+        // Mini-batch KMeans: each iteration moves the nearest centroid of every point of a random batch towards it,
+        // with a learning rate of weight / (weight of the points assigned to the centroid so far). The points are assigned at the end.
+        void compute_clusters_mini_batch();
+
+        // Assigns every point to its nearest centroid in parallel, setting its squared distance to it,
+        // and returns the number of points whose cluster changed. If computations is given, it is set to
+        // the number of distances computed. For many clusters, the nearest centroid may be approximate
+        // (see kmeans_options::centroid_index_clusters).
+        int assign_all(std::vector<int> &assignment, std::vector<double> &dist, long long *computations=NULL);
+
+        // Sets every centroid to the weighted mean of the points assigned to it by the given assignment
+        // and returns the clusters that have no points.
+        std::vector<int> update_means(const std::vector<int> &assignment);
+
+        // Gives each of the given empty clusters the point that is farthest from its centroid, according to
+        // the given distances, and sets the distance of that point to 0. Returns the points given to the clusters.
+        std::vector<int> reseed(const std::vector<int> &empty_clusters, std::vector<int> &assignment, std::vector<double> &dist);
+
+        // Moves every point to its cluster in the given assignment.
+        void move_points(const std::vector<int> &assignment);
+
+        // Starts counting the iterations of a clustering method and opens the iteration log.
+        void begin_iterations();
+
+        // Records an iteration in which the given number of points changed cluster (-1 if unknown) and the given
+        // number of distances were computed, and returns true if any of the stopping criteria of the options holds.
+        // The objective is computed only if it is needed and not given.
+        bool end_iteration(int moved, long long computations, double objective=std::numeric_limits<double>::quiet_NaN());
+
+        // Reverse Search: in each loop, the balls of radius r, 2r, 4r, ... around every centroid are found with
+        // the given range query, which returns the points of each ring between two successive radii.
+        // The queries run in parallel and a point found in several balls goes to the nearest centroid.
+        void compute_clusters_reverse(const std::function<std::vector<std::tuple<std::vector<int>, std::vector<double>>>(
+                                          const std::vector<double>&, const std::vector<double>&)> &query_range);
         void compute_clusters_reverse_lsh();
         void compute_clusters_reverse_hypercube();
 
+        // Builds the indices of Reverse Search, unless they already exist with the current parameters.
+        void build_lsh_index();
+        void build_hypercube_index();
+
+        // Runs the given number of restarts of the clustering (options.restarts) in parallel, on instances that
+        // share the dataset, and keeps the clusters of the one with the lowest objective.
+        void compute_clusters_restarts(int, update_method, const std::tuple<int,int,int,int,int,double,int> &config);
+        std::vector<double> restart_objectives; // Objective of every restart of the last clustering.
+
+        // Runs the clustering on a weighted coreset of the dataset (options.coreset_size points) with another instance
+        // and assigns every point of the dataset to the nearest of its centroids.
+        void compute_clusters_coreset(int, update_method, const std::tuple<int,int,int,int,int,double,int> &config);
+
+        // Weight of every point of the dataset in the centroids and the objective, or empty if all weights are 1,
+        // and total weight of the points of each cluster, kept by move_point() only if there are weights.
+        std::vector<double> weights;
+        std::vector<double> cluster_weights;
+        double weight(int index) const { return weights.empty() ? 1 : weights[index]; }
+        double cluster_weight(int cluster) const { return weights.empty() ? cluster_sizes[cluster] : cluster_weights[cluster]; }
+
+        // Returns the sum of the given values of the points of the dataset, multiplied by their weights.
+        double weighted_sum(const std::vector<double>&) const;
+
         int number_of_hash_tables, k_lsh, max_points_checked, k_hypercube, probes, limit_queries;
         double window;
 
+        std::string lsh_index_file; // File of a saved LSH index, empty to always build the index.
+
+        // Indices of the Reverse Search, kept for later calls of compute_clusters() and rebuilt only if
+        // their parameters change.
+        LSH *lsh_index = NULL;
+        std::tuple<int, int, double, std::string> lsh_parameters;
+        hypercube *hypercube_index = NULL;
+        std::tuple<int, int, int, double> hypercube_parameters;
+        kmeans_options options;
+
+        // Projection of the hypercube of the centroids (see kmeans_options::centroid_index_clusters), learned
+        // in the first iteration of a clustering and reused by the later ones, or NULL.
+        LearnedProjection *centroid_projection = NULL;
+
+        // Random numbers of the sampling of mini-batch KMeans, one engine per instance so that restarts
+        // running in parallel never share it.
+        std::mt19937 random_engine;
+
+        // State of the iterations of the current clustering method, see end_iteration().
+        int iteration;
+        double last_objective;
+        std::vector<std::vector<double>> last_centroids;
+        std::chrono::steady_clock::time_point start_time;
+        std::ofstream iteration_log;
+
     protected:
         std::vector<std::vector<double>> centroids;
 
-        // Array of sets of points, where clusters[i] is the set of points of the i-th cluster
-        // unordered_set is used to for fast lookup and deletion in specific cluster.
-        std::vector<std::unordered_set<int>> clusters;
-
         // Point_to_cluster[i] = j means that the i-th point of the dataset belongs to the j-th cluster (zero-indexed).
-        // Needs to  be updated together with clusters.
+        // Needs to be updated together with cluster_sizes, i.e. through move_point().
         std::vector<int> point_to_cluster;
 
-        std::unordered_map<int, int> point_2_cluster;
+        // Number of points of each cluster.
+        std::vector<int> cluster_sizes;
+
+        // Points of each cluster, built from point_to_cluster by build_clusters(): the points of the i-th cluster are
+        // cluster_points[cluster_offsets[i], cluster_offsets[i + 1]), in increasing order, so that the points
+        // of a cluster are visited in the order they are stored in the dataset.
+        std::vector<int> cluster_offsets;
+        std::vector<int> cluster_points;
+
+        // Moves the given point to the given cluster.
+        void move_point(int index, int cluster);
+
+        // Builds cluster_offsets and cluster_points from point_to_cluster with a counting sort.
+        void build_clusters();
 
         const std::vector<std::vector<double>> &dataset;
     public:
         // Initializes an instance.
         // The argument is the dataset the clustering algorithms will be applied to.
         KMeans(const std::vector<std::vector<double>>& dataset);
+        ~KMeans();
+
+        // The indices of the Reverse Search are owned by the instance.
+        KMeans(const KMeans&) = delete;
+        KMeans &operator=(const KMeans&) = delete;
+
+        // Sets the file the LSH index of the Reverse Search is loaded from (if it exists) or saved to.
+        void set_lsh_index_file(const std::string&);
+
+        // Sets the options of the clustering methods.
+        void set_options(const kmeans_options&);
 
         // Computes internally the clusters using the number of clusters, the given method and the the following tuple:
         /*
@@ -74,10 +239,20 @@ class KMeans
         // Returns the indices of the datapoints inside each cluster.
         std::vector<std::vector<int>> get_clusters() const;
 
+        // Returns the objective of the clusters, i.e. the sum of the squared distances of the points
+        // to the centroids of their clusters (multiplied by their weights on a coreset).
+        double objective() const;
+
+        // Returns the objective of every restart of the last clustering, or nothing if it had no restarts.
+        std::vector<double> get_restart_objectives() const { return restart_objectives; }
+
         int get_dataset_size() const { return dataset.size(); }
 
         static constexpr double (*distance)(const std::vector<double>&, const std::vector<double>&) = euclidean_distance;
         
         // Returns the silhouette of the i-th point of the dataset.
         double silhouette(int i);
+
+        // Returns the silhouette of every cluster and of the whole dataset, computed with the given options.
+        silhouette_result silhouette(const silhouette_options&) const;
 };
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+// Data-dependent projection of points to the vertices of a k-dimensional hypercube (Iterative Quantization).
+// The centered data is projected to its first k principal components, which are then rotated so that
+// the sign bits of the rotated values lose as little information as possible.
+class LearnedProjection
+{
+private:
+	int k;                                   // Number of bits k.
+	std::vector<double> mean;                // Mean of the training data.
+	std::vector<std::vector<double>> W;      // k d-dimensional orthonormal directions (principal components rotated by ITQ).
+
+	// Returns an orthonormal basis of the subspace spanned by the given k vectors (Gram-Schmidt).
+	static std::vector<std::vector<double>> orthonormalize(std::vector<std::vector<double>>);
+
+public:
+	// Trains a projection to k bits on a sample of at most max_samples points of the given dataset,
+	// using the given number of ITQ iterations.
+	LearnedProjection(const std::vector<std::vector<double>> &p, int k, int iterations=50, int max_samples=10000);
+
+	// Returns the real values of the projection of q, one for each bit. Bit i is 1 if value i is positive
+	// and, since the directions are orthonormal, |value i| is the distance of q to the hyperplane of bit i.
+	std::vector<double> project(const std::vector<double> &q) const;
+
+	// Returns the vertex of q, i.e. the vertex with bit i equal to 1 if value i of its projection is positive.
+	uint64_t hash(const std::vector<double> &q) const;
+
+	// Returns the number of bits k.
+	int get_k() const { return k; }
+};
\ No newline at end of file
@@ -67,6 +67,13 @@ template <typename T> class List
         // Returns the number of nodes in the list.
         int get_count() const;
 
+        // Calls the given function with the data stored in each node, from first to last.
+        // Unlike get_data, it does not change the state of the list.
+        template <typename F> void for_each(F) const;
+
+        // Removes the nodes whose data satisfy the given predicate and returns the number of nodes removed.
+        template <typename P> int remove_if(P);
+
         friend std::ostream& operator<<(std::ostream& os, const List<T>& list)
         {
             ListNode<T> *current;
@@ -135,6 +142,8 @@ template <typename T> void List<T>::insert_first(T data)
     new_first_node->set_next_node(old_first_node);
     head = new_first_node;
     count++;
+    recent_node = NULL; // Indices have changed.
+    recent_index = 0;
 }
 
 // Inserts the given data in the last node.
@@ -153,6 +162,8 @@ template <typename T> void List<T>::insert_last(T data)
     }
     previous_node->set_next_node(new_last_node);
     count++;
+    recent_node = NULL; // Indices have changed.
+    recent_index = 0;
 }
 
 // Removes and returns the data stored in the first node.
@@ -167,6 +178,8 @@ template <typename T> T List<T>::remove_first()
     T data = to_be_removed->get_data();
     delete to_be_removed;
     count--;
+    recent_node = NULL; // Indices have changed and the recent node may have been deleted.
+    recent_index = 0;
     return data;
 }
 
@@ -191,6 +204,8 @@ template <typename T> T List<T>::remove_last()
     void *data = to_be_removed->get_data();
     delete to_be_removed;
     count--;
+    recent_node = NULL; // Indices have changed and the recent node may have been deleted.
+    recent_index = 0;
     return data;
 }
 
@@ -240,4 +255,42 @@ template <typename T> T List<T>::get_data(int index, bool &valid)
 template <typename T> int List<T>::get_count() const
 {
     return count;
+}
+
+// Calls the given function with the data stored in each node, from first to last.
+// Unlike get_data, it does not change the state of the list.
+template <typename T> template <typename F> void List<T>::for_each(F function) const
+{
+    for(ListNode<T> *node = head; node != NULL; node = node->get_next_node()){
+        function(node->get_data());
+    }
+}
+
+// Removes the nodes whose data satisfy the given predicate and returns the number of nodes removed.
+template <typename T> template <typename P> int List<T>::remove_if(P predicate)
+{
+    int removed = 0;
+    ListNode<T> *previous_node = NULL;
+    ListNode<T> *node = head;
+    while(node != NULL){
+        ListNode<T> *next_node = node->get_next_node();
+        if(predicate(node->get_data())){
+            if(previous_node == NULL){
+                head = next_node;
+            }
+            else{
+                previous_node->set_next_node(next_node);
+            }
+            delete node;
+            removed++;
+        }
+        else{
+            previous_node = node;
+        }
+        node = next_node;
+    }
+    count -= removed;
+    recent_node = NULL; // Indices have changed and the recent node may have been deleted.
+    recent_index = 0;
+    return removed;
 }
\ No newline at end of file
@@ -2,10 +2,36 @@
 
 #include <vector>
 #include <tuple>
+#include <fstream>
+#include <unordered_map>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <atomic>
 
 #include "hash_table.hpp"
 #include "lp_metric.hpp"
 
+// Iterator over the approximate nearest neighbours of a query, in increasing order of distance.
+// The candidates are found once, when the iterator is created by LSH::query_iterator(),
+// and kept in a heap, so asking for more neighbours does not scan the buckets again.
+class LSHNeighborIterator
+{
+    private:
+        std::vector<std::tuple<double, int>> heap; // Min-heap of the remaining candidates (distance, index).
+
+    public:
+        // Initializes an iterator with the given candidates (distance, index), which must be unique.
+        LSHNeighborIterator(std::vector<std::tuple<double, int>>);
+
+        // Returns the indices of the next m nearest neighbours and their distances to the query,
+        // or fewer if there are not enough candidates left.
+        std::tuple<std::vector<int>, std::vector<double>> next(unsigned int m);
+
+        // Returns true if there are candidates left.
+        bool has_next() const;
+};
+
 class LSH
 {
     private:
@@ -16,18 +42,90 @@ class LSH
         const int number_of_hash_tables; // Number of hash tables L.
         HashTable<std::vector<double>, int> **hash_tables; // Hash tables.
 
+        // Pool of m hash functions shared by the hash tables, each of which uses k of them.
+        // Empty if each hash table has its own k hash functions.
+        std::vector<HashFunction*> hash_function_pool;
+
         const std::vector<std::vector<double>> &dataset;
-    
+
+        // points[id] is the point with the given id, or NULL if the id has been removed (tombstone).
+        // Points of the dataset have their dataset index as id.
+        std::vector<const std::vector<double>*> points;
+        std::unordered_map<int, std::vector<double>> inserted_points; // Points inserted after initialization.
+        int number_of_points;     // Number of points that have not been removed.
+        int number_of_tombstones; // Number of removed points that are still stored in the hash tables.
+
+        // Number of times each id has been inserted again after being removed, since the last compaction.
+        // The hash tables may still hold entries of its removed point, in buckets other than those of the new point.
+        std::unordered_map<int, int> reinserted_ids;
+
+        double compaction_threshold;        // Ratio of tombstones that triggers a background compaction.
+        std::atomic<bool> compacting;       // Indicates if a background compaction is running.
+        std::thread compaction_thread;      // Thread of the most recent background compaction.
+        std::mutex compaction_mutex;        // Held while compaction_thread is joined or started.
+        mutable std::shared_mutex mutex;    // Shared by queries, exclusive for insertions, removals and compaction.
+
         // Inserts the given data point with the given index to all L hash tables. 
-        void insert(std::vector<double>, int);
+        void insert_to_tables(const std::vector<double>&, int);
+
+        // Returns the ID of the given point in each of the L hash tables.
+        // With a shared pool, only the m hash functions of the pool are computed.
+        std::vector<unsigned int> hash_ids(const std::vector<double>&) const;
+
+        // Reads an integer from the given file, used to initialize the constant members when loading.
+        static int read_int(std::ifstream&);
+
+        // Checks the magic number and the version at the start of an index file and returns the integer
+        // that follows them. Throws std::runtime_error if they are not the ones written by save().
+        static int read_header(std::ifstream&);
+
+        // Deletes the hash tables and the hash functions of the pool.
+        void free_index();
 
     public:
         // Initializes an instance with the given number of hash functions,
         // number of hash tables, table size and window.
-        // The last argument is the set of points the LSH algorithm will be applied to.
-        LSH(int, int, int, double, const std::vector<std::vector<double>>&);
+        // The next argument is the set of points the LSH algorithm will be applied to.
+        // If the last argument m is positive, the hash tables share a pool of m >= k hash functions (more if there are
+        // fewer than L combinations of k of them), each one using a different combination of k of them,
+        // so that hashing a point costs m instead of k * L projections.
+        LSH(int, int, int, double, const std::vector<std::vector<double>>&, int pool_size=0);
+
+        // Initializes an instance from an index file written by save(), without rebuilding the hash tables.
+        // The last argument must be the same dataset the index was built on.
+        // Throws std::runtime_error if the file is not an index file of the current version, does not match
+        // the dataset or is corrupted.
+        LSH(std::ifstream&, const std::vector<std::vector<double>>&);
         ~LSH();
 
+        // Saves the index (magic number, format version, parameters, hash functions and bucket contents) to a .bin file.
+        void save(std::ofstream&) const;
+
+        // Inserts the given point with the given id to the index and returns true,
+        // or returns false if a point with the same id is already in the index.
+        // Ids of removed points can be reused.
+        bool insert(int, const std::vector<double>&);
+
+        // Removes the point with the given id and returns true, or returns false if there is no such point.
+        // The point is only marked as removed (tombstone) and skipped by the queries, until a compaction
+        // removes it from the hash tables. If the ratio of tombstones exceeds the compaction threshold,
+        // a compaction is started in the background.
+        bool remove(int);
+
+        // Removes all tombstones from the hash tables, and the entries of removed points whose ids have been
+        // inserted again, which are found by their buckets. Each hash table is locked separately, so queries
+        // are only blocked while one table is compacted.
+        void compact();
+
+        // Sets the ratio of tombstones (to all points in the hash tables) that triggers a background compaction.
+        void set_compaction_threshold(double);
+
+        // Returns the point with the given id, or NULL if there is no such point.
+        const std::vector<double>* get_point(int) const;
+
+        // Returns the number of points in the index, excluding the removed ones.
+        int get_number_of_points() const;
+
         // Returns the indices of the k-approximate nearest neighbours (ANN) of the given query q
         // and their distances to the query based on the given distance function.
         // Last parameter indicates whether or not the Querying trick is applied.
@@ -35,10 +133,26 @@ class LSH
                                                                 double (*distance)(const std::vector<double>&, const std::vector<double>&) = euclidean_distance,
                                                                 bool querying_trick=true);
 
+        // Returns an iterator over the approximate nearest neighbours of the given query q, in increasing order
+        // of distance based on the given distance function. Last parameter indicates whether or not the Querying trick is applied.
+        // Unlike query(), the number of neighbours does not have to be known in advance.
+        LSHNeighborIterator query_iterator(const std::vector<double>&,
+                                           double (*distance)(const std::vector<double>&, const std::vector<double>&) = euclidean_distance,
+                                           bool querying_trick=true) const;
+
         // Returns the indices of the k-approximate nearest neighbours (ANN) of the given query q
         // and their distances to the query based on the given distance function.
         // All the neighbours returned lie within radius r.
         std::tuple<std::vector<int>, std::vector<double>> query_range(const std::vector<double>&, double r,
                                                                       double (*distance)(const std::vector<double>&, const std::vector<double>&) = euclidean_distance,
                                                                       bool limit_queries=false);
+
+        // Returns, for each of the given radii (sorted in increasing order), the indices of the k-approximate nearest neighbours (ANN)
+        // of the given query q and their distances to the query based on the given distance function, that lie within this radius
+        // but not within any of the previous radii. The buckets are scanned and the distances computed only once for all radii.
+        // If limit_queries is set, each radius stops taking points after 20 * L neighbours are found within it, as if it
+        // were queried on its own, and each point goes to the ring of the smallest radius that contains it and still takes points.
+        std::vector<std::tuple<std::vector<int>, std::vector<double>>> query_range(const std::vector<double>&, const std::vector<double>& radii,
+                                                                                   double (*distance)(const std::vector<double>&, const std::vector<double>&) = euclidean_distance,
+                                                                                   bool limit_queries=false);
 };
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <tuple>
+
+#include "lp_metric.hpp"
+
+// LSH parameters, along with the recall@N, average query time and memory of the index they give.
+struct lsh_config
+{
+    int k;             // Number of hash functions k of each hash table.
+    int L;             // Number of hash tables L.
+    int table_size;    // Hash table size.
+    double window;     // Window w.
+    double recall;     // Recall@N.
+    double query_time; // Average query time in seconds.
+    double memory;     // Estimated memory of the hash tables in MB.
+};
+
+// Searches the (k, L, w, table_size) space for the cheapest LSH configuration that achieves a target recall@N
+// under a query time and a memory budget.
+// The collision probability of a single hash function is estimated empirically for every pair of a sampled query
+// and one of its exact nearest neighbours or a random point of the dataset, so that the recall and the number of
+// candidates of every configuration can be estimated without building it. The cheapest configurations according
+// to this cost model are then built and measured on the sampled queries.
+class LSHTuner
+{
+    private:
+        const std::vector<std::vector<double>> &dataset;
+        const unsigned int N;                           // Number of nearest neighbours the recall is measured for.
+
+        std::vector<std::vector<double>> queries;       // Sampled queries.
+        std::vector<std::vector<int>> true_neighbours;  // Exact N nearest neighbours of each sampled query.
+        std::vector<int> random_points;                 // Indices of random points of the dataset.
+        double average_neighbour_distance;              // Average distance of a sampled query to its N nearest neighbours.
+
+        // Returns the estimated collision probabilities of a single hash function with the given window for every pair
+        // of a sampled query and one of its nearest neighbours (first) or one of the random points (second).
+        std::tuple<std::vector<double>, std::vector<double>> collision_probabilities(double window) const;
+
+        // Builds an LSH with the given configuration and sets its recall@N and average query time on the sampled queries.
+        void evaluate(lsh_config&) const;
+
+    public:
+        // Initializes a tuner for the given dataset and number of nearest neighbours N.
+        // The last two arguments are the queries (points of the dataset are sampled if empty)
+        // and the number of queries sampled from them.
+        LSHTuner(const std::vector<std::vector<double>>&, unsigned int N,
+                 const std::vector<std::vector<double>>&, unsigned int number_of_queries=100);
+
+        // Returns the cheapest configuration found with recall@N at least the given target, average query time
+        // at most the given time (in seconds) and memory at most the given memory (in MB).
+        // Non-positive budgets are ignored. If no configuration meets the target, the one with the highest
+        // measured recall is returned.
+        lsh_config tune(double target_recall, double max_query_time=0, double max_memory=0);
+};
+
+// Writes the given configuration to a configuration file, using the same keys as `cluster.conf` and a `table_size` key.
+void write_lsh_config(const std::string&, const lsh_config&);
+
+// Reads the LSH parameters (k, L, table size, window) from the given configuration file.
+// Parameters that are not in the file keep the values of the given configuration.
+lsh_config read_lsh_config(const std::string&, lsh_config);
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <functional>
+
+// Returns the number of threads used for a loop over the given number of items,
+// i.e. the number of hardware threads, but at most one per item.
+// Inside a parallel loop, only the hardware threads left to the current thread are counted.
+int number_of_threads_for(int number_of_items);
+
+// Splits [0, n) into one contiguous part per thread and calls function(thread, begin, end) for every part in parallel.
+void parallel_for(int n, int number_of_threads, const std::function<void(int, int, int)> &function);
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include "lp_metric.hpp"
+
+typedef enum {SILHOUETTE_EXACT, SILHOUETTE_SAMPLED, SILHOUETTE_SIMPLIFIED} silhouette_method;
+
+// Options of the silhouette computation.
+struct silhouette_options
+{
+    silhouette_method method = SILHOUETTE_EXACT;
+    int sample_size = 500;    // Points sampled from each cluster by SILHOUETTE_SAMPLED.
+    double confidence = 0.95; // Confidence level of the intervals of SILHOUETTE_SAMPLED.
+};
+
+struct silhouette_result
+{
+    std::vector<double> clusters; // Average silhouette of the points of each cluster.
+    double total = 0;             // Average silhouette of all points.
+    // Half-widths of the confidence intervals of the above, only computed by SILHOUETTE_SAMPLED.
+    std::vector<double> cluster_margins;
+    double total_margin = 0;
+};
+
+// Returns the silhouette of the given clustering of the dataset, where the i-th point belongs to the
+// point_to_cluster[i]-th cluster and the points of the c-th cluster are cluster_points[cluster_offsets[c],
+// cluster_offsets[c + 1]). The silhouette of a point is (b - a) / max(a, b), where a is its average distance
+// to the points of its cluster and b its average distance to the points of the cluster with the nearest
+// of the given centroids, apart from its own.
+// SILHOUETTE_EXACT computes it for every point, in parallel, with the distances of the points of every pair
+// of clusters computed once, in tiles. SILHOUETTE_SAMPLED computes it only for a random sample of every cluster
+// and also returns confidence intervals. SILHOUETTE_SIMPLIFIED uses the distances to the two centroids as a and b.
+silhouette_result compute_silhouette(const std::vector<std::vector<double>> &dataset, const std::vector<int> &point_to_cluster,
+                                     const std::vector<int> &cluster_offsets, const std::vector<int> &cluster_points,
+                                     const std::vector<std::vector<double>> &centroids, const silhouette_options &options,
+                                     double (*distance)(const std::vector<double>&, const std::vector<double>&) = euclidean_distance);
\ No newline at end of file
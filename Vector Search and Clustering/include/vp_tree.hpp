@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+#include <tuple>
+
+#include "lp_metric.hpp"
+
+// Vantage-point tree for exact (and optionally approximate) nearest neighbour and range queries
+// in any metric space. Each internal node splits its points around a random vantage point
+// by their median distance to it, and the queries prune subtrees using the triangle inequality.
+class VPTree
+{
+    private:
+        struct Node
+        {
+            int vantage_point;   // Index of the vantage point, or -1 for a leaf.
+            double radius;       // Median distance of the points of the node to the vantage point.
+            int inside;          // Child with the points at distance <= radius, or -1.
+            int outside;         // Child with the points at distance >= radius, or -1.
+            int leaf_begin;      // The points of a leaf are indices[leaf_begin, leaf_end).
+            int leaf_end;
+        };
+
+        const std::vector<std::vector<double>> &dataset;
+        double (*distance)(const std::vector<double>&, const std::vector<double>&);
+        const int leaf_size;          // Maximum number of points of a leaf.
+
+        std::vector<Node> nodes;      // nodes[0] is the root.
+        std::vector<int> indices;     // Indices of the points, grouped by leaf.
+
+        // Builds the subtree of the points indices[begin, end) and returns its node.
+        int build(int begin, int end);
+
+        // Visits the nodes in increasing order of their distance lower bound from q and keeps the points
+        // within the current bound, i.e. the distance of the N-th nearest neighbour for N > 0 or radius R otherwise.
+        // If max_leaves is positive, the search stops after max_leaves leaves have been visited.
+        std::tuple<std::vector<int>, std::vector<double>> search(const std::vector<double> &q, unsigned int N, double R,
+                                                                 int max_leaves, bool skip_query) const;
+
+    public:
+        // Builds a tree for the given dataset with the given distance function and maximum leaf size.
+        VPTree(const std::vector<std::vector<double>>&,
+               double (*distance)(const std::vector<double>&, const std::vector<double>&) = euclidean_distance,
+               int leaf_size=16);
+
+        // Returns the indices of the N nearest neighbours of q and their distances to q, sorted by distance.
+        // Points equal to q are skipped, as in brute_force(). The result is exact if max_leaves is not positive,
+        // otherwise approximate, visiting at most max_leaves leaves in order of their distance lower bound.
+        // Unlike brute_force(), which keeps a single point per distance, points at the same distance are all
+        // returned (e.g. duplicates of the dataset), and ties at the N-th distance go to the smaller indices.
+        // The ground truth on data with duplicates therefore differs from the one of brute_force(), by design.
+        std::tuple<std::vector<int>, std::vector<double>> query(const std::vector<double> &q, unsigned int N,
+                                                                int max_leaves=0) const;
+
+        // Returns the indices of the points that lie within radius R of q and their distances to q, sorted by distance.
+        std::tuple<std::vector<int>, std::vector<double>> query_range(const std::vector<double> &q, double R) const;
+};
\ No newline at end of file